@@ -2,33 +2,693 @@
 #include <stdlib.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
+#include <stdarg.h>
 
 #ifdef _OPENMP
 #include <omp.h>
+#include <sched.h>
+#include <pthread.h>
 #define getClock() omp_get_wtime()
 #else
 #include <time.h>
 #define getClock() ((double)clock() / CLOCKS_PER_SEC)
 #endif
 
-#define MAX_JOBS 8
-#define MAX_MACHINES 8
-#define MAX_TOTAL_NODES 10000000000
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+// Núcleo AVX2 do bound por job: compilado só em x86, escolhido em tempo de execução
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <x86intrin.h>
+#define HAVE_AVX2_KERNEL
+#endif
+
+#define MAX_TOTAL_NODES 10000000000LL // Limite de nos por omissao (ver --node-limit)
 
+#define WORK_DEQUE_CAPACITY 1024 // Capacidade de cada deque de subproblemas por thread
+#define TT_BUCKET_SIZE 4          // Entradas por balde da tabela de transposição
+#define SPLIT_MIN_REMAINING_OPS 6 // So se doam subarvores com pelo menos este numero de operacoes por agendar
+#define NODE_FLUSH_INTERVAL 1024  // Nos contados localmente antes de serem somados ao total partilhado
+#define PROGRESS_INTERVAL 5000000 // Nos entre mensagens de progresso
+#define CHECKPOINT_VERSION 1      // Versao do formato binario do checkpoint
+#define BOUND_LANES 8             // Inteiros de 32 bits num registo AVX2
+#define BENCH_STATES 256          // Estados aleatorios do microbenchmark do bound
+
+// As dimensões da instância só são conhecidas depois de ler o cabeçalho do ficheiro,
+// por isso todos os vetores são reservados dinamicamente em read_input. Os vetores
+// por operação usam o índice j * num_machines + op; os que têm uma posição extra
+// por job (após a última operação) usam j * (num_machines + 1) + op.
 int num_jobs, num_machines;
-int job_machine[MAX_JOBS][MAX_MACHINES];
-int job_duration[MAX_JOBS][MAX_MACHINES];
+int num_ops;        // num_jobs * num_machines
+int machine_stride; // Máximo de operações numa máquina (capacidade das listas do lower bound)
+int *job_machine;
+int *job_duration;
 
 int best_makespan;
-int best_schedule[MAX_JOBS][MAX_MACHINES];
-long long nodes_explored = 0;
+int *best_schedule;
+long long nodes_explored = 0; // Total partilhado, atualizado em lotes de NODE_FLUSH_INTERVAL nos por thread
+
+// Incumbente publicado durante a busca: makespan nos 32 bits altos e, nos baixos, o
+// buffer que guarda o escalonamento (INCUMBENT_HEURISTIC = best_schedule). Por ser um
+// único inteiro, o par é trocado com uma comparação atómica, sem lock.
+#define INCUMBENT_HEURISTIC 0xFFFFFFFFULL
+unsigned long long best_incumbent = 0;
+
+// Modo anytime: orçamentos de nós e de tempo (--node-limit, --time-limit). Quando um
+// se esgota, search_stop guarda o motivo e todas as threads abandonam a busca no
+// nó seguinte, deixando os nós abertos para o cálculo do lower bound global.
+#define STOP_NONE 0
+#define STOP_NODES 1
+#define STOP_TIME 2
+
+long long node_limit = MAX_TOTAL_NODES;
+double time_limit = 0; // Segundos; 0 = sem limite
+double search_start_time = 0;
+double search_deadline = 0;
+int search_stop = STOP_NONE;
+const char *stop_names[] = {"busca completa", "limite de nos", "limite de tempo"};
+int global_lower_bound = 0;
 
-int job_remaining_time[MAX_JOBS][MAX_MACHINES + 1];
+// Cronologia dos incumbentes encontrados pela busca
+typedef struct
+{
+    double time; // Segundos desde o início da busca
+    int makespan;
+    long long nodes;
+} IncumbentEvent;
+
+IncumbentEvent *incumbent_timeline = NULL;
+int timeline_size = 0;
+int timeline_capacity = 0;
+
+int *job_remaining_time;
+int *job_prefix_time; // Soma das durações das operações anteriores a cada operação
 
 double global_start_time = 0;
 
+// Lower bounds disponíveis, escolhidos em tempo de execução com --bound
+#define BOUND_SIMPLE 0  // Simulação não preemptiva pela ordem do tempo mais cedo de início
+#define BOUND_JACKSON 1 // Escalonamento preemptivo de Jackson com cabeças e caudas por máquina
+
+int bound_type = BOUND_SIMPLE;
+const char *bound_names[] = {"simple", "jackson"};
+
+// Esquemas de ramificação, escolhidos em tempo de execução com --branching
+#define BRANCHING_ALL 0    // Ramifica em todos os jobs com operações por agendar
+#define BRANCHING_ACTIVE 1 // Giffler-Thompson: só gera escalonamentos ativos
+
+int branching_type = BRANCHING_ALL;
+const char *branching_names[] = {"all", "active"};
+
+// Modos de busca, escolhidos em tempo de execução com --search. Só o exato garante o
+// ótimo; os outros cortam filhos e o resultado só é provado ótimo se o lower bound
+// global (que inclui os nós cortados) chegar ao makespan.
+#define SEARCH_EXACT 0 // Todos os filhos de cada nó
+#define SEARCH_BEAM 1  // Feixe: no máximo a largura da profundidade do nó (--beam-widths)
+#define SEARCH_LDS 2   // Limited discrepancy search: o i-ésimo filho custa i discrepâncias
+
+int search_mode = SEARCH_BEAM;
+const char *search_mode_names[] = {"exact", "beam", "lds"};
+
+// Larguras do feixe por profundidade: beam_widths[i] aplica-se às profundidades abaixo
+// de beam_depths[i] (a última até ao fim); 0 = sem limite
+#define MAX_BEAM_LEVELS 16
+#define DEFAULT_BEAM_WIDTHS "15:all,20:3,2"
+int beam_depths[MAX_BEAM_LEVELS];
+int beam_widths[MAX_BEAM_LEVELS];
+int beam_levels = 0;
+const char *beam_spec = DEFAULT_BEAM_WIDTHS;
+int beam_spec_given = 0;
+int lds_max_discrepancies = 3; // Discrepâncias permitidas em cada caminho (--lds-discrepancies)
+
+// Regras de dominância aplicadas aos candidatos de cada nó, escolhidas com --dominance
+#define DOMINANCE_COMMUTE 0 // Passos independentes seguidos só pela ordem dos índices dos jobs
+#define DOMINANCE_IDLE 1    // Candidato que deixaria a máquina parada o tempo de outra operação
+#define NUM_DOMINANCE_RULES 2
+
+int dominance_mask = (1 << NUM_DOMINANCE_RULES) - 1; // Regras ativas (bit 1 << regra)
+const char *dominance_names[] = {"comutacao", "tempo ocioso"};
+long long dominance_prunes[NUM_DOMINANCE_RULES]; // Filhos podados por cada regra
+
+// Estratégias de busca, escolhidas em tempo de execução com --strategy
+#define STRATEGY_DFS 0    // Profundidade primeiro com pilha explícita
+#define STRATEGY_BEST 1   // Best-first: expande sempre o nó aberto de menor lower bound
+#define STRATEGY_HYBRID 2 // DFS até ao primeiro incumbente da busca, depois best-first
+
+int strategy_type = STRATEGY_DFS;
+const char *strategy_names[] = {"dfs", "best", "hybrid"};
+
+// Incumbente inicial, escolhido em tempo de execução com --heuristic
+#define HEURISTIC_INDEX 0     // Só a heurística original: jobs pela ordem do índice
+#define HEURISTIC_PORTFOLIO 1 // Portfólio de regras de despacho, corrido em paralelo
+
+int heuristic_type = HEURISTIC_PORTFOLIO;
+const char *heuristic_names[] = {"index", "portfolio"};
+
+// Regras de despacho do portfólio (escalonamentos ativos de Giffler-Thompson)
+#define RULE_INDEX 0          // Heurística original (fora do portfólio)
+#define RULE_SPT 1            // Menor duração da operação
+#define RULE_LPT 2            // Maior duração da operação
+#define RULE_MWKR 3           // Mais trabalho por fazer no job
+#define RULE_MOPNR 4          // Mais operações por fazer no job
+#define RULE_RANDOM 5         // Escolha aleatória, uma execução por semente
+#define NUM_RANDOM_DISPATCH 64
+
+const char *rule_names[] = {"indice", "SPT", "LPT", "MWKR", "MOPNR", "aleatoria"};
+int heuristic_winner = RULE_INDEX;
+int heuristic_winner_seed = 0;
+int heuristic_runs = 0;
+double heuristic_time = 0;
+int index_makespan = 0;       // Makespan da heurística original, para comparação
+int *index_schedule = NULL;
+int heuristic_baseline = 0;   // --heuristic-baseline: mede a busca a partir da heurística original
+long long baseline_nodes = 0;
+int baseline_makespan = 0;
+double baseline_wall = 0;
+
+// Modo determinístico (--deterministic): a busca avança por rondas sincronizadas. Em
+// cada ronda, cada tarefa (subproblema com índice fixo na lista da ronda) é explorada
+// em DFS com o incumbente do início da ronda e um orçamento de nós; o que fica aberto
+// passa para a ronda seguinte pela ordem das tarefas e as melhorias do incumbente são
+// aplicadas no fim, também por essa ordem. Assim o resultado, os nós e o ponto de
+// paragem por limite de nós dependem só da instância, nunca da ordem das threads.
+#define DET_TASK_NODES 65536 // Orçamento de nós de cada tarefa por ronda
+
+int deterministic_mode = 0;
+int deterministic_compare = 0; // --deterministic-compare: mede antes a busca livre
+long long det_rounds = 0;
+long long det_tasks = 0;
+double det_barrier_time = 0;   // Tempo das threads parado à espera do fim das rondas
+long long free_nodes = 0;      // Busca livre de referência (--deterministic-compare)
+int free_makespan = 0;
+double free_wall = 0;
+
+#define PHASE_DFS 0
+#define PHASE_BEST 1
+
+int search_phase = PHASE_DFS;    // Fase global; no modo híbrido passa a PHASE_BEST uma única vez
+double phase_switch_time = -1;   // Segundos desde o início da busca até à mudança de fase
+long long phase_switch_nodes = 0;
+long long pool_memory_mb = 256;  // Limite de memória do pool de nós do best-first (--pool-mb)
+
+// Dimensões usadas pelos núcleos da busca. Os núcleos especializados recebem-nas como
+// constantes, o que permite ao compilador fixar os offsets e desenrolar os ciclos.
+typedef struct
+{
+    int jobs;
+    int machines;
+    int stride; // Capacidade de cada lista de máquina no motor do lower bound
+} Dims;
+
+// Subproblema aberto: estado parcial completo a partir do qual a busca continua. É
+// guardado num bloco contíguo de subproblem_ints inteiros com o layout
+// [schedule J*M | job_completion J | machine_completion M | job_next_op J | depth |
+// discrepancies | last_job]; esta estrutura só aponta para as partes de um bloco.
+typedef struct
+{
+    int *schedule; // schedule[j * num_machines + op]
+    int *job_completion;
+    int *machine_completion;
+    int *job_next_op;
+    int *depth;
+    int *discrepancies; // Soma das posições dos filhos escolhidos desde a raiz (LDS)
+    int *last_job;      // Job da última operação aplicada (-1 na raiz), para a regra da comutação
+} Subproblem;
+
+int subproblem_ints = 0;
+
+static inline Subproblem subproblem_view(int *block, const Dims d)
+{
+    Subproblem sp;
+    sp.schedule = block;
+    sp.job_completion = block + d.jobs * d.machines;
+    sp.machine_completion = sp.job_completion + d.jobs;
+    sp.job_next_op = sp.machine_completion + d.machines;
+    sp.depth = sp.job_next_op + d.jobs;
+    sp.discrepancies = sp.depth + 1;
+    sp.last_job = sp.discrepancies + 1;
+    return sp;
+}
+
+Dims instance_dims()
+{
+    Dims d = {num_jobs, num_machines, machine_stride};
+    return d;
+}
+
+// Reserva memória ou termina o programa com uma mensagem de erro
+void *checked_malloc(size_t size, const char *what)
+{
+    void *ptr = malloc(size > 0 ? size : 1);
+    if (!ptr)
+    {
+        printf("ERRO: Memoria insuficiente para %s\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+// Registo de eventos assíncrono: cada thread escreve as mensagens num anel próprio (um
+// produtor e um consumidor, sem locks) e uma thread de escrita esvazia os anéis para o
+// stdout pela ordem temporal. Com o anel cheio a mensagem é descartada e contada, para
+// que a busca nunca espere. Com --log=quiet o único custo é o teste do nível, e
+// compilando com -DLOG_DISABLED nem esse fica. Sem OpenMP escreve diretamente.
+#define LOG_QUIET 0
+#define LOG_INFO 1  // Incumbentes, progresso e checkpoints
+#define LOG_DEBUG 2 // Cada solução completa encontrada
+
+#define LOG_RING_SIZE 1024          // Mensagens por anel (potência de 2)
+#define LOG_MESSAGE_SIZE 160        // Caracteres por mensagem, incluindo o terminador
+#define LOG_FLUSH_MICROSECONDS 1000 // Pausa da thread de escrita entre passagens
+
+typedef struct
+{
+    double time;
+    char text[LOG_MESSAGE_SIZE];
+} LogMessage;
+
+typedef struct
+{
+    LogMessage *messages;
+    unsigned long long head; // Próxima posição a escrever (só a thread dona a altera)
+    long long dropped;       // Mensagens descartadas por o anel estar cheio
+    char padding[64];        // head e tail em linhas de cache diferentes
+    unsigned long long tail; // Próxima posição a escrever no stdout (só a thread de escrita)
+} LogRing;
+
+int log_level = LOG_INFO;
+const char *log_level_names[] = {"quiet", "info", "debug"};
+LogRing *log_rings = NULL; // Um anel por thread, enquanto o registo assíncrono está ativo
+int log_num_rings = 0;
+long long log_dropped = 0;
+#ifdef _OPENMP
+unsigned long long *log_heads = NULL; // Cópia das cabeças lida em cada passagem
+pthread_t log_flusher;
+int log_running = 0;
+#endif
+
+#ifdef LOG_DISABLED
+#define LOG(level, ...) ((void)0)
+#else
+#define LOG(level, ...)               \
+    do                                \
+    {                                 \
+        if ((level) <= log_level)     \
+            log_message(__VA_ARGS__); \
+    } while (0)
+#endif
+
+void log_message(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+#ifdef _OPENMP
+    int tid = omp_get_thread_num();
+    if (log_rings && tid < log_num_rings)
+    {
+        LogRing *ring = &log_rings[tid];
+        unsigned long long head = ring->head;
+        if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE)
+        {
+            ring->dropped++;
+        }
+        else
+        {
+            LogMessage *message = &ring->messages[head & (LOG_RING_SIZE - 1)];
+            message->time = getClock();
+            vsnprintf(message->text, LOG_MESSAGE_SIZE, format, args);
+            __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+        }
+        va_end(args);
+        return;
+    }
+#endif
+    // Fora do registo assíncrono (antes de log_start ou sem OpenMP)
+    vprintf(format, args);
+    va_end(args);
+}
+
+#ifdef _OPENMP
+// Escreve as mensagens já publicadas, juntando os anéis pela ordem temporal
+void log_drain()
+{
+    for (int r = 0; r < log_num_rings; r++)
+    {
+        log_heads[r] = __atomic_load_n(&log_rings[r].head, __ATOMIC_ACQUIRE);
+    }
+
+    int written = 0;
+    for (;;)
+    {
+        int next = -1;
+        double next_time = 0;
+        for (int r = 0; r < log_num_rings; r++)
+        {
+            LogRing *ring = &log_rings[r];
+            if (ring->tail == log_heads[r])
+                continue;
+            double time = ring->messages[ring->tail & (LOG_RING_SIZE - 1)].time;
+            if (next < 0 || time < next_time)
+            {
+                next = r;
+                next_time = time;
+            }
+        }
+        if (next < 0)
+            break;
+
+        LogRing *ring = &log_rings[next];
+        fputs(ring->messages[ring->tail & (LOG_RING_SIZE - 1)].text, stdout);
+        __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+        written = 1;
+    }
+    if (written)
+        fflush(stdout);
+}
+
+void *log_flusher_main(void *arg)
+{
+    (void)arg;
+    struct timespec pause = {0, LOG_FLUSH_MICROSECONDS * 1000L};
+    while (__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+    {
+        log_drain();
+        nanosleep(&pause, NULL);
+    }
+    log_drain();
+    return NULL;
+}
+#endif
+
+// Liga o registo assíncrono: um anel por thread e a thread de escrita
+void log_start()
+{
+#ifdef _OPENMP
+    if (log_level == LOG_QUIET || log_rings)
+        return;
+    log_num_rings = omp_get_max_threads();
+    log_rings = (LogRing *)checked_malloc(sizeof(LogRing) * log_num_rings, "o registo de eventos");
+    log_heads = (unsigned long long *)checked_malloc(sizeof(unsigned long long) * log_num_rings, "o registo de eventos");
+    for (int r = 0; r < log_num_rings; r++)
+    {
+        log_rings[r].messages = (LogMessage *)checked_malloc(sizeof(LogMessage) * LOG_RING_SIZE, "o registo de eventos");
+        log_rings[r].head = 0;
+        log_rings[r].tail = 0;
+        log_rings[r].dropped = 0;
+    }
+    fflush(stdout);
+    log_running = 1;
+    if (pthread_create(&log_flusher, NULL, log_flusher_main, NULL) != 0)
+    {
+        // Sem thread de escrita, as mensagens voltam a ser escritas diretamente
+        for (int r = 0; r < log_num_rings; r++)
+            free(log_rings[r].messages);
+        free(log_rings);
+        free(log_heads);
+        log_rings = NULL;
+        log_running = 0;
+    }
+#endif
+}
+
+// Desliga o registo assíncrono depois de escrever as mensagens pendentes
+void log_stop()
+{
+#ifdef _OPENMP
+    if (!log_rings)
+        return;
+    __atomic_store_n(&log_running, 0, __ATOMIC_RELEASE);
+    pthread_join(log_flusher, NULL);
+    for (int r = 0; r < log_num_rings; r++)
+    {
+        log_dropped += log_rings[r].dropped;
+        free(log_rings[r].messages);
+    }
+    free(log_rings);
+    free(log_heads);
+    log_rings = NULL;
+#endif
+}
+
+// Perfil da busca, opcional em tempo de compilação (-DSEARCH_PROFILE): cada thread conta
+// os nós e as podas por profundidade e causa, a distribuição do lower bound relativo ao
+// incumbente e os ciclos gastos em bounds, na ramificação e a copiar estados. Os perfis
+// são somados no fim e escritos em CSV ao lado do ficheiro de métricas. Sem a macro,
+// PROFILE(...) não gera código.
+#define PROFILE_NODES 0
+#define PROFILE_PRUNE_BOUND 1
+#define PROFILE_PRUNE_DOMINANCE 2
+#define PROFILE_PRUNE_TRANSPOSITION 3
+#define PROFILE_PRUNE_DEPTH 4        // Profundidade acima do máximo razoável
+#define PROFILE_PRUNE_BRANCH_LIMIT 5 // Filhos cortados pelo feixe ou pelo LDS
+#define PROFILE_COLUMNS 6
+
+#define PROFILE_BOUND_BUCKETS 20 // Intervalos de 5% de lower bound / incumbente, mais um para >= 100%
+
+#define PROFILE_BOUNDING 0
+#define PROFILE_BRANCHING 1
+#define PROFILE_STATE_COPY 2
+#define NUM_PROFILE_PHASES 3
+
+const char *profile_column_names[] = {"nos", "podas_bound", "podas_dominancia", "podas_transposicao",
+                                      "podas_profundidade", "podas_limite_ramos"};
+const char *profile_phase_names[] = {"bound", "ramificacao", "copia_estado"};
+long long *search_profile = NULL; // Soma dos perfis das threads (e dos ranks)
+
+#ifdef SEARCH_PROFILE
+#define PROFILE(...) __VA_ARGS__
+#else
+#define PROFILE(...)
+#endif
+
+// Layout de um perfil: [(num_ops + 1) profundidades x PROFILE_COLUMNS |
+// PROFILE_BOUND_BUCKETS + 1 intervalos | NUM_PROFILE_PHASES ciclos]
+static inline int profile_bound_offset()
+{
+    return (num_ops + 1) * PROFILE_COLUMNS;
+}
+
+static inline int profile_cycles_offset()
+{
+    return profile_bound_offset() + PROFILE_BOUND_BUCKETS + 1;
+}
+
+static inline int profile_size()
+{
+    return profile_cycles_offset() + NUM_PROFILE_PHASES;
+}
+
+static inline void profile_count(long long *profile, int depth, int column, long long amount)
+{
+    if (depth > num_ops)
+        depth = num_ops;
+    profile[depth * PROFILE_COLUMNS + column] += amount;
+}
+
+// Regista a razão lower bound / incumbente de um nó avaliado
+static inline void profile_bound(long long *profile, int lower_bound, int incumbent)
+{
+    int bucket = PROFILE_BOUND_BUCKETS;
+    if (lower_bound < incumbent)
+        bucket = (int)((long long)lower_bound * PROFILE_BOUND_BUCKETS / incumbent);
+    profile[profile_bound_offset() + bucket]++;
+}
+
+// Contador de ciclos do processador (em x86) ou nanossegundos monotónicos
+static inline unsigned long long profile_cycles()
+{
+#ifdef HAVE_AVX2_KERNEL
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+static inline void profile_add_cycles(long long *profile, int phase, unsigned long long start)
+{
+    profile[profile_cycles_offset() + phase] += (long long)(profile_cycles() - start);
+}
+
+// Deque de subproblemas de uma thread: o dono empilha e desempilha no fim (LIFO),
+// os ladroes retiram do inicio (subproblemas mais antigos, mais perto da raiz)
+typedef struct
+{
+    int *items; // WORK_DEQUE_CAPACITY blocos de subproblem_ints inteiros
+    int head; // Indice do subproblema mais antigo
+    int tail; // Posicao livre a seguir ao subproblema mais recente
+#ifdef _OPENMP
+    omp_lock_t lock;
+#endif
+    char padding[64]; // Evita partilha falsa entre deques vizinhos
+} WorkDeque;
+
+WorkDeque *work_deques = NULL;
+int num_workers = 1;
+long long outstanding_work = 0; // Subproblemas em deques ou em processamento
+int idle_threads = 0;           // Threads sem trabalho a tentar roubar
+long long steals_performed = 0;
+long long subproblems_donated = 0;
+
+// Pool de nós do best-first: os subproblemas avaliados ficam em blocos de tamanho
+// fixo reservados de uma vez (até pool_memory_mb) e um heap ordena-os pelo lower
+// bound. Com o pool cheio, quem quer guardar um nó continua em DFS a partir dele.
+typedef struct
+{
+    int bound;
+    int depth;
+    int slot; // Bloco do subproblema em NodePool.blocks
+} PoolEntry;
+
+typedef struct
+{
+    int *blocks;     // capacity blocos de subproblem_ints inteiros
+    int *free_slots; // Pilha de blocos livres
+    int free_count;
+    PoolEntry *heap; // Min-heap por bound; em empate, o mais profundo primeiro
+    int size;
+    int capacity;
+    int peak;
+#ifdef _OPENMP
+    omp_lock_t lock;
+#endif
+} NodePool;
+
+NodePool node_pool; // Reservado em node_pool_init
+long long pool_fallbacks = 0; // Nós continuados em DFS por o pool estar cheio
+
+int node_pool_size()
+{
+    int size;
 #ifdef _OPENMP
-omp_lock_t best_lock;
+#pragma omp atomic read
+#endif
+    size = node_pool.size;
+    return size;
+}
+
+// Registos de subproblemas abertos em formato compacto: cada registo é um prefixo
+// (sequência de jobs agendados a partir da raiz) seguido dos jobs dos filhos ainda
+// por explorar; sem filhos, o próprio prefixo é o subproblema aberto.
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    long long records;
+} CheckpointBuffer;
+
+// Estado privado de cada thread, numa linha de cache própria: o contador de nós só é
+// somado ao total partilhado de tempos a tempos e o makespan do incumbente é lido de
+// uma cópia local, refrescada nessas mesmas alturas.
+typedef struct
+{
+    int id;
+    int incumbent;               // Cópia local do melhor makespan publicado
+    int published_buffer;        // Buffer desta thread referido por best_incumbent (-1 se nenhum)
+    int *schedules;              // Dois buffers de num_ops inteiros para escalonamentos completos
+    long long nodes;             // Nós explorados por esta thread
+    long long flushed_nodes;     // Parte de nodes já somada a nodes_explored
+    long long shared_nodes;      // Valor de nodes_explored visto no último lote
+    int open_bound;              // Menor lower bound dos nós deixados abertos ao parar
+    int truncated_bound;         // Menor lower bound dos nós com filhos cortados (feixe ou LDS)
+    long long pool_fallbacks;    // Nós que esta thread não conseguiu guardar no pool
+    long long dominance_prunes[NUM_DOMINANCE_RULES]; // Candidatos podados por cada regra de dominância
+    long long *profile;          // Perfil da busca desta thread (só com SEARCH_PROFILE)
+    long long task_node_cap;     // Modo determinístico: valor de nodes em que a tarefa é suspensa
+    int task_suspended;          // A tarefa esgotou o orçamento com nós por explorar
+    CheckpointBuffer checkpoint; // Fronteira desta thread no último checkpoint
+    char padding[64];            // Evita partilha falsa entre threads vizinhas
+} ThreadState;
+
+ThreadState *thread_states = NULL;
+
+// Checkpoint periódico da fronteira de busca (ver --checkpoint e --resume). A thread 0
+// pede um checkpoint; cada thread codifica a sua fronteira no próximo ponto seguro e,
+// quando todas chegaram, a última junta os deques e o incumbente numa imagem em
+// memória, liberta as outras e só então escreve o ficheiro.
+const char *checkpoint_filename = NULL;
+const char *resume_filename = NULL;
+double checkpoint_interval = 10.0;
+double next_checkpoint_time = 0;
+int checkpoint_requested = 0;
+int checkpoint_generation = 0;      // Pedido em curso
+int checkpoint_done_generation = 0; // Último pedido concluído
+int checkpoint_arrived = 0;
+int checkpoint_closing = 0;
+int active_workers = 0;             // Threads que ainda não saíram do ciclo de busca
+long long checkpoints_written = 0;
+double checkpoint_max_pause = 0;    // Maior pausa de uma thread num checkpoint (segundos)
+double checkpoint_prior_wall = 0;   // Tempos das execuções anteriores, lidos do checkpoint
+double checkpoint_prior_cpu = 0;
+CheckpointBuffer checkpoint_image = {NULL, 0, 0, 0};
+
+// Subproblemas lidos de um checkpoint, distribuídos pelas threads a pedido
+typedef struct
+{
+    long long offset; // Início do prefixo em resume_jobs
+    int length;
+    int last_job;     // Job agendado a seguir ao prefixo (-1 se nenhum)
+} ResumeNode;
+
+ResumeNode *resume_nodes = NULL;
+int *resume_jobs = NULL;
+long long resume_count = 0;
+long long resume_next = 0;
+
+// Tabela de transposição partilhada (0 entradas = desativada, ver --tt-size)
+long long tt_requested_entries = 0;
+long long tt_probes = 0;
+long long tt_hits = 0;
+long long tt_stores = 0;
+long long tt_replacements = 0;
+
+// Execução em vários processos (compilada com -DUSE_MPI e lançada com mpirun). Cada
+// rank corre a busca com roubo de trabalho entre as suas threads sobre a sua parte dos
+// subproblemas da raiz; só a thread 0 de cada rank fala MPI (MPI_THREAD_FUNNELED).
+// Um rank sem trabalho pede subproblemas a outro, as melhorias do incumbente são
+// difundidas a todos e a terminação é detetada com o algoritmo de Dijkstra-Safra.
+int mpi_rank = 0; // Sem USE_MPI há um único processo
+int mpi_size = 1;
+
+#ifdef USE_MPI
+#define MPI_TAG_INCUMBENT 1
+#define MPI_TAG_STEAL_REQUEST 2
+#define MPI_TAG_STEAL_REPLY 3
+#define MPI_TAG_TOKEN 4
+#define MPI_TAG_DONE 5
+#define MPI_SPLIT_FACTOR 4        // Subproblemas da raiz por rank na divisão inicial
+#define MPI_STEAL_MAX 16          // Subproblemas enviados no máximo por resposta a um pedido
+#define MPI_STEAL_BACKOFF 0.001   // Pausa (segundos) depois de todos os ranks recusarem um pedido
+
+int remote_makespan = INT_MAX;    // Melhor makespan recebido de outro rank (só poda)
+int mpi_known_makespan = INT_MAX; // Menor makespan já difundido ou recebido por este rank
+int mpi_done = 0;                 // Terminação global confirmada
+int mpi_work_requested = 0;       // Um pedido foi recusado: as threads devem doar nós
+int mpi_steal_pending = 0;        // Há um pedido deste rank à espera de resposta
+int mpi_next_victim = 0;
+int mpi_failed_steals = 0;
+double mpi_next_steal_time = 0;
+long long mpi_work_balance = 0;   // Mensagens com trabalho enviadas menos recebidas (Safra)
+int mpi_black = 0;                // Recebeu trabalho desde a última passagem do testemunho
+int mpi_token_out = 0;            // Rank 0: o testemunho está a circular
+int mpi_has_token = 0;
+long long mpi_token[2];           // Soma dos saldos e cor do testemunho recebido
+long long mpi_broadcasts = 0;     // Melhorias do incumbente difundidas por este rank
+long long mpi_incumbents_received = 0;
+long long mpi_subproblems_sent = 0;
+long long mpi_subproblems_received = 0;
+double mpi_idle_time = 0;         // Tempo em que o rank esteve sem trabalho
+int *mpi_buffer = NULL;           // MPI_STEAL_MAX blocos de subproblemas
+long long mpi_total_node_limit = 0;
+long long *mpi_rank_nodes = NULL; // Rank 0: nós e tempo ocioso de cada rank
+double *mpi_rank_idle = NULL;
+
+void mpi_poll();
 #endif
 
 void read_input(const char *input_filename)
@@ -43,49 +703,96 @@ void read_input(const char *input_filename)
     }
 
     // Lê o número de jobs e de máquinas do ficheiro
-    fscanf(input, "%d %d", &num_jobs, &num_machines);
-    printf("Problema: %d jobs, %d machines\n", num_jobs, num_machines);
+    if (fscanf(input, "%d %d", &num_jobs, &num_machines) != 2 || num_jobs <= 0 || num_machines <= 0)
+    {
+        printf("ERRO: Cabecalho invalido no ficheiro %s\n", input_filename);
+        exit(1);
+    }
+    if (mpi_rank == 0)
+        printf("Problema: %d jobs, %d machines\n", num_jobs, num_machines);
+
+    // Reserva os vetores da instância com as dimensões lidas
+    num_ops = num_jobs * num_machines;
+    job_machine = (int *)checked_malloc(sizeof(int) * num_ops, "a instancia");
+    job_duration = (int *)checked_malloc(sizeof(int) * num_ops, "a instancia");
+    best_schedule = (int *)checked_malloc(sizeof(int) * num_ops, "a instancia");
+    job_remaining_time = (int *)checked_malloc(sizeof(int) * num_jobs * (num_machines + 1), "a instancia");
+    job_prefix_time = (int *)checked_malloc(sizeof(int) * num_jobs * (num_machines + 1), "a instancia");
 
     // Lê, para cada job, a sequência de máquinas e suas durações
     for (int j = 0; j < num_jobs; j++)
     {
         for (int op = 0; op < num_machines; op++)
         {
-            fscanf(input, "%d %d", &job_machine[j][op], &job_duration[j][op]);
+            int *machine = &job_machine[j * num_machines + op];
+            if (fscanf(input, "%d %d", machine, &job_duration[j * num_machines + op]) != 2 ||
+                *machine < 0 || *machine >= num_machines)
+            {
+                printf("ERRO: Operacao %d do job %d invalida no ficheiro %s\n", op, j, input_filename);
+                exit(1);
+            }
         }
     }
     fclose(input); // Fecha o ficheiro após a leitura
 
     // Calcula o tempo restante de processamento para cada operação de cada job
+    int stride = num_machines + 1;
     for (int j = 0; j < num_jobs; j++)
     {
-        job_remaining_time[j][num_machines] = 0; // Inicializa o tempo restante após a última operação como zero
+        job_remaining_time[j * stride + num_machines] = 0; // Inicializa o tempo restante após a última operação como zero
         for (int op = num_machines - 1; op >= 0; op--)
         {
             // Soma a duração da operação atual ao tempo restante das operações seguintes
-            job_remaining_time[j][op] = job_remaining_time[j][op + 1] + job_duration[j][op];
+            job_remaining_time[j * stride + op] = job_remaining_time[j * stride + op + 1] + job_duration[j * num_machines + op];
+        }
+
+        // Somas prefixas usadas pelo motor incremental do lower bound
+        job_prefix_time[j * stride] = 0;
+        for (int op = 0; op < num_machines; op++)
+        {
+            job_prefix_time[j * stride + op + 1] = job_prefix_time[j * stride + op] + job_duration[j * num_machines + op];
         }
     }
 
-    // Exibe os dados lidos do problema para conferência
+    // Capacidade das listas por máquina: número máximo de operações numa máquina
+    int machine_ops[num_machines];
+    for (int m = 0; m < num_machines; m++)
+    {
+        machine_ops[m] = 0;
+    }
+    machine_stride = 0;
+    for (int i = 0; i < num_ops; i++)
+    {
+        if (++machine_ops[job_machine[i]] > machine_stride)
+            machine_stride = machine_ops[job_machine[i]];
+    }
+    subproblem_ints = num_ops + 2 * num_jobs + num_machines + 3;
+
+    // Exibe os dados lidos do problema para conferência (uma vez, no rank 0)
+    if (mpi_rank != 0)
+        return;
     printf("\nDados do problema:\n");
     for (int j = 0; j < num_jobs; j++)
     {
         printf("Job %d: ", j);
         for (int op = 0; op < num_machines; op++)
         {
-            printf("(M%d,%d) ", job_machine[j][op], job_duration[j][op]);
+            printf("(M%d,%d) ", job_machine[j * num_machines + op], job_duration[j * num_machines + op]);
         }
         printf("\n");
     }
     printf("\n");
 }
 
-int get_initial_upper_bound()
+// Heurística original: agenda os jobs pela ordem do índice, um job inteiro de cada
+// vez, e guarda o escalonamento em schedule; devolve o makespan
+int get_initial_upper_bound(int *schedule)
 {
     // Vetores temporários para armazenar o tempo de conclusão de cada job e máquina
-    int temp_job_completion[MAX_JOBS] = {0};
-    int temp_machine_completion[MAX_MACHINES] = {0};
+    int temp_job_completion[num_jobs];
+    int temp_machine_completion[num_machines];
+    memset(temp_job_completion, 0, sizeof(temp_job_completion));
+    memset(temp_machine_completion, 0, sizeof(temp_machine_completion));
 
     // Para cada job
     for (int j = 0; j < num_jobs; j++)
@@ -93,13 +800,14 @@ int get_initial_upper_bound()
         // Para cada operação do job
         for (int op = 0; op < num_machines; op++)
         {
-            int machine = job_machine[j][op];   // Máquina da operação atual
-            int duration = job_duration[j][op]; // Duração da operação atual
+            int machine = job_machine[j * num_machines + op];   // Máquina da operação atual
+            int duration = job_duration[j * num_machines + op]; // Duração da operação atual
 
             // O início da operação é o maior valor entre o término do job e o término da máquina
             int start_time = (temp_job_completion[j] > temp_machine_completion[machine]) ? temp_job_completion[j] : temp_machine_completion[machine];
 
             // Atualiza o tempo de conclusão do job e da máquina
+            schedule[j * num_machines + op] = start_time;
             temp_job_completion[j] = start_time + duration;
             temp_machine_completion[machine] = start_time + duration;
         }
@@ -116,362 +824,4196 @@ int get_initial_upper_bound()
     return makespan; // Retorna o makespan como upper bound inicial
 }
 
-int is_dominated_state(int job_completion[], int machine_completion[], int job_next_op[])
+// Gerador splitmix64, usado para as chaves Zobrist e pelas regras de despacho aleatórias
+unsigned long long splitmix64(unsigned long long *seed)
 {
-    // Verifica se algum estado é dominado, ou seja, se algum job está muito atrasado em relação a outro com a mesma próxima operação
-    for (int j1 = 0; j1 < num_jobs; j1++)
-    {
-        for (int j2 = j1 + 1; j2 < num_jobs; j2++)
-        {
-            if (job_next_op[j1] == job_next_op[j2])
-            {
-                // Define um limiar de atraso baseado no melhor makespan conhecido
-                int delay_threshold = (best_makespan * 2) / 3;
-                // Se o job j1 está muito mais atrasado que j2, o estado é dominado
-                if (job_completion[j1] > job_completion[j2] + delay_threshold)
-                {
-                    return 1;
-                }
-            }
-        }
-    }
-
-    return 0; // Estado não dominado
+    unsigned long long z = (*seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-int calculate_improved_lower_bound(int job_completion[], int machine_completion[], int job_next_op[])
+// Escalonamento ativo de Giffler-Thompson: a operação disponível que termina mais cedo
+// define a máquina em conflito e a regra escolhe qual das operações dessa máquina que
+// podem começar antes desse instante é agendada. Em empate ganha o job de menor índice.
+int dispatch_schedule(int rule, unsigned long long seed, int *schedule)
 {
-    int max_bound = 0;
-
-    // Calcula o bound baseado no tempo restante de cada job
-    for (int j = 0; j < num_jobs; j++)
-    {
-        int job_bound = job_completion[j] + job_remaining_time[j][job_next_op[j]];
-        if (job_bound > max_bound)
-            max_bound = job_bound;
-    }
+    int job_completion[num_jobs];
+    int machine_completion[num_machines];
+    int next_op[num_jobs];
+    memset(job_completion, 0, sizeof(job_completion));
+    memset(machine_completion, 0, sizeof(machine_completion));
+    memset(next_op, 0, sizeof(next_op));
 
-    // Para cada máquina, calcula o bound considerando as operações restantes nela
-    for (int m = 0; m < num_machines; m++)
+    int makespan = 0;
+    for (int step = 0; step < num_ops; step++)
     {
-        int remaining_work = 0;
-        int earliest_available = machine_completion[m];
-
-        // Estrutura para armazenar informações das operações restantes na máquina m
-        typedef struct
-        {
-            int job;
-            int op;
-            int earliest_start;
-            int duration;
-        } OpInfo;
-        OpInfo ops[MAX_JOBS * MAX_MACHINES];
-        int num_ops = 0;
-
-        // Coleta todas as operações restantes para a máquina m
+        int min_completion = INT_MAX;
+        int min_job = -1;
+        int conflict_machine = -1;
         for (int j = 0; j < num_jobs; j++)
         {
-            for (int op = job_next_op[j]; op < num_machines; op++)
+            if (next_op[j] == num_machines)
+                continue;
+            int k = j * num_machines + next_op[j];
+            int start = (job_completion[j] > machine_completion[job_machine[k]]) ? job_completion[j] : machine_completion[job_machine[k]];
+            if (start + job_duration[k] < min_completion)
             {
-                if (job_machine[j][op] == m)
-                {
-                    ops[num_ops].job = j;
-                    ops[num_ops].op = op;
-                    ops[num_ops].duration = job_duration[j][op];
-
-                    // Calcula o tempo mais cedo que a operação pode começar
-                    int job_ready_time = job_completion[j];
-                    for (int prev_op = job_next_op[j]; prev_op < op; prev_op++)
-                    {
-                        job_ready_time += job_duration[j][prev_op];
-                    }
-                    ops[num_ops].earliest_start = job_ready_time;
-                    num_ops++;
-                }
+                min_completion = start + job_duration[k];
+                min_job = j;
+                conflict_machine = job_machine[k];
             }
         }
 
-        // Ordena as operações pelo tempo mais cedo de início (selection sort)
-        for (int i = 0; i < num_ops - 1; i++)
+        int chosen = -1;
+        long long chosen_key = 0;
+        for (int j = 0; j < num_jobs; j++)
         {
-            for (int k = i + 1; k < num_ops; k++)
+            if (next_op[j] == num_machines)
+                continue;
+            int k = j * num_machines + next_op[j];
+            int start = (job_completion[j] > machine_completion[job_machine[k]]) ? job_completion[j] : machine_completion[job_machine[k]];
+            // A operação que define min_completion entra sempre: com duração 0 começa
+            // nesse instante e seria a única excluída pela desigualdade estrita
+            if (job_machine[k] != conflict_machine || (start >= min_completion && j != min_job))
+                continue;
+
+            // Chave da regra: ganha a maior
+            long long key;
+            switch (rule)
             {
-                if (ops[k].earliest_start < ops[i].earliest_start)
-                {
-                    OpInfo temp = ops[i];
-                    ops[i] = ops[k];
-                    ops[k] = temp;
-                }
+            case RULE_SPT:
+                key = -job_duration[k];
+                break;
+            case RULE_LPT:
+                key = job_duration[k];
+                break;
+            case RULE_MWKR:
+                key = job_remaining_time[j * (num_machines + 1) + next_op[j]];
+                break;
+            case RULE_MOPNR:
+                key = num_machines - next_op[j];
+                break;
+            default:
+                key = (long long)(splitmix64(&seed) >> 2);
+                break;
             }
-        }
-
-        // Simula o processamento das operações na máquina m
-        int current_time = earliest_available;
-        for (int i = 0; i < num_ops; i++)
-        {
-            if (ops[i].earliest_start > current_time)
+            if (chosen < 0 || key > chosen_key)
             {
-                current_time = ops[i].earliest_start;
+                chosen = j;
+                chosen_key = key;
             }
-            current_time += ops[i].duration;
         }
 
-        // Atualiza o bound máximo se necessário
-        if (current_time > max_bound)
-            max_bound = current_time;
+        if (chosen < 0)
+        {
+            printf("ERRO: Nenhuma operacao em conflito no passo %d do despacho\n", step);
+            exit(1);
+        }
+        int k = chosen * num_machines + next_op[chosen];
+        int start = (job_completion[chosen] > machine_completion[job_machine[k]]) ? job_completion[chosen] : machine_completion[job_machine[k]];
+        schedule[k] = start;
+        job_completion[chosen] = start + job_duration[k];
+        machine_completion[job_machine[k]] = start + job_duration[k];
+        next_op[chosen]++;
+        if (job_completion[chosen] > makespan)
+            makespan = job_completion[chosen];
     }
-
-    return max_bound; // Retorna o melhor lower bound encontrado
+    return makespan;
 }
 
-int all_jobs_complete(int job_next_op[])
+// Corre as regras de despacho em paralelo e guarda a melhor em best_makespan e
+// best_schedule. Com --heuristic=index usa só a heurística original. Os empates são
+// resolvidos pela ordem do portfólio, por isso o resultado não depende das threads.
+void run_heuristic_portfolio()
 {
-    // Verifica se todos os jobs já completaram todas as operações
-    for (int j = 0; j < num_jobs; j++)
+    double start = getClock();
+    index_schedule = (int *)checked_malloc(sizeof(int) * num_ops, "a heuristica inicial");
+    index_makespan = get_initial_upper_bound(index_schedule);
+    best_makespan = index_makespan;
+    memcpy(best_schedule, index_schedule, sizeof(int) * num_ops);
+    heuristic_winner = RULE_INDEX;
+    heuristic_winner_seed = 0;
+    heuristic_runs = 1;
+    if (heuristic_type == HEURISTIC_INDEX)
     {
-        if (job_next_op[j] < num_machines)
-            return 0; // Ainda há operações a serem feitas
+        heuristic_time = getClock() - start;
+        return;
     }
-    return 1; // Todos os jobs estão completos
-}
 
-void update_best_solution(int schedule[MAX_JOBS][MAX_MACHINES], int makespan)
-{
+    // Entradas: as regras determinísticas seguidas de NUM_RANDOM_DISPATCH sementes
+    int entries = RULE_RANDOM - 1 + NUM_RANDOM_DISPATCH;
+    int *schedules = (int *)checked_malloc(sizeof(int) * num_ops * entries, "o portfolio de heuristicas");
+    int *makespans = (int *)checked_malloc(sizeof(int) * entries, "o portfolio de heuristicas");
 #ifdef _OPENMP
-    // Se estiver usando OpenMP, trava o acesso à melhor solução para evitar condições de corrida
-    omp_set_lock(&best_lock);
+#pragma omp parallel for schedule(dynamic)
 #endif
+    for (int e = 0; e < entries; e++)
+    {
+        int rule = (e < RULE_RANDOM - 1) ? e + 1 : RULE_RANDOM;
+        unsigned long long seed = (unsigned long long)(e - (RULE_RANDOM - 1));
+        makespans[e] = dispatch_schedule(rule, seed, schedules + (size_t)e * num_ops);
+    }
 
-    // Verifica se o novo makespan é melhor (menor) que o melhor encontrado até agora
-    if (makespan < best_makespan)
+    for (int e = 0; e < entries; e++)
     {
-        best_makespan = makespan; // Atualiza o melhor makespan
-        // Copia o agendamento atual para o melhor agendamento encontrado
-        for (int j = 0; j < num_jobs; j++)
+        if (makespans[e] < best_makespan)
         {
-            for (int op = 0; op < num_machines; op++)
-            {
-                best_schedule[j][op] = schedule[j][op];
-            }
+            best_makespan = makespans[e];
+            memcpy(best_schedule, schedules + (size_t)e * num_ops, sizeof(int) * num_ops);
+            heuristic_winner = (e < RULE_RANDOM - 1) ? e + 1 : RULE_RANDOM;
+            heuristic_winner_seed = e - (RULE_RANDOM - 1);
         }
+    }
+    heuristic_runs = entries + 1;
+    heuristic_time = getClock() - start;
+    free(schedules);
+    free(makespans);
+}
 
-#ifdef _OPENMP
-        // Imprime mensagem informando a nova melhor solução, incluindo o número da thread
-        printf("Nova melhor solucao: makespan = %d (thread %d, nos: %lld)\n",
-               best_makespan, omp_get_thread_num(), nodes_explored);
-#else
-        // Imprime mensagem informando a nova melhor solução (versão sequencial)
-        printf("Nova melhor solucao: makespan = %d (nos: %lld)\n",
-               best_makespan, nodes_explored);
+// Motor incremental do lower bound: para cada máquina mantém a lista das operações
+// restantes ordenada por (cabeça, job, operação). A cabeça de uma operação é o tempo
+// mais cedo em que o job a pode iniciar, obtido a partir das somas prefixas do job.
+typedef struct
+{
+    int head;     // Tempo mais cedo de início da operação
+    int job;      // Job a que pertence a operação
+    int op;       // Índice da operação dentro do job
+    int duration; // Duração da operação
+} BoundEntry;
+
+typedef struct
+{
+    BoundEntry *entries; // entries[m * stride + i]: lista ordenada da máquina m
+    int *count;          // Número de operações restantes em cada máquina
+    int *job_terms;      // Termo do bound de cada job, com zeros até múltiplo de BOUND_LANES
+    int *batch_jobs;     // Lote de filhos em SoA: job agendado por cada filho,
+    int *batch_own;      // novo termo desse job (início + tempo restante)
+    int *batch_bounds;   // e bound por job resultante
+} BoundEngine;
+
+// Atributo dos núcleos da busca: são sempre expandidos dentro da instância especializada
+#define BNB_KERNEL static inline __attribute__((always_inline))
+
+// Compara duas entradas pela chave de ordenação (cabeça, job, operação)
+BNB_KERNEL int bound_entry_before(const BoundEntry *a, const BoundEntry *b)
+{
+    if (a->head != b->head)
+        return a->head < b->head;
+    if (a->job != b->job)
+        return a->job < b->job;
+    return a->op < b->op;
+}
+
+// Procura a posição da operação (j, op) na lista da máquina m
+BNB_KERNEL int bound_engine_find(BoundEngine *engine, int m, int j, int op, const Dims d)
+{
+    BoundEntry *list = &engine->entries[m * d.stride];
+    for (int i = 0; i < engine->count[m]; i++)
+    {
+        if (list[i].job == j && list[i].op == op)
+            return i;
+    }
+    return -1;
+}
+
+// Altera a cabeça da entrada na posição pos e repõe a ordenação por inserção
+BNB_KERNEL void bound_engine_move(BoundEngine *engine, int m, int pos, int new_head, const Dims d)
+{
+    BoundEntry *list = &engine->entries[m * d.stride];
+    BoundEntry entry = list[pos];
+    entry.head = new_head;
+
+    while (pos + 1 < engine->count[m] && bound_entry_before(&list[pos + 1], &entry))
+    {
+        list[pos] = list[pos + 1];
+        pos++;
+    }
+    while (pos > 0 && bound_entry_before(&entry, &list[pos - 1]))
+    {
+        list[pos] = list[pos - 1];
+        pos--;
+    }
+    list[pos] = entry;
+}
+
+void bound_engine_alloc(BoundEngine *engine)
+{
+    engine->entries = (BoundEntry *)checked_malloc(sizeof(BoundEntry) * num_machines * machine_stride, "o motor do lower bound");
+    engine->count = (int *)checked_malloc(sizeof(int) * num_machines, "o motor do lower bound");
+    int padded_jobs = (num_jobs + BOUND_LANES - 1) / BOUND_LANES * BOUND_LANES;
+    engine->job_terms = (int *)checked_malloc(sizeof(int) * padded_jobs, "o motor do lower bound");
+    for (int j = 0; j < padded_jobs; j++)
+        engine->job_terms[j] = 0;
+    engine->batch_jobs = (int *)checked_malloc(sizeof(int) * num_jobs, "o motor do lower bound");
+    engine->batch_own = (int *)checked_malloc(sizeof(int) * num_jobs, "o motor do lower bound");
+    engine->batch_bounds = (int *)checked_malloc(sizeof(int) * num_jobs, "o motor do lower bound");
+}
+
+void bound_engine_free(BoundEngine *engine)
+{
+    free(engine->entries);
+    free(engine->count);
+    free(engine->job_terms);
+    free(engine->batch_jobs);
+    free(engine->batch_own);
+    free(engine->batch_bounds);
+}
+
+// Constrói as listas ordenadas a partir de um estado parcial qualquer
+void bound_engine_init(BoundEngine *engine, int job_completion[], int job_next_op[])
+{
+    int stride = num_machines + 1;
+    for (int m = 0; m < num_machines; m++)
+    {
+        engine->count[m] = 0;
+    }
+
+    for (int j = 0; j < num_jobs; j++)
+    {
+        for (int op = job_next_op[j]; op < num_machines; op++)
+        {
+            int m = job_machine[j * num_machines + op];
+            BoundEntry *entry = &engine->entries[m * machine_stride + engine->count[m]++];
+            entry->job = j;
+            entry->op = op;
+            entry->duration = job_duration[j * num_machines + op];
+            entry->head = job_completion[j] + job_prefix_time[j * stride + op] - job_prefix_time[j * stride + job_next_op[j]];
+        }
+    }
+
+    // Ordenação por inserção de cada lista (feita apenas no início de cada subproblema)
+    for (int m = 0; m < num_machines; m++)
+    {
+        BoundEntry *list = &engine->entries[m * machine_stride];
+        for (int i = 1; i < engine->count[m]; i++)
+        {
+            BoundEntry entry = list[i];
+            int k = i;
+            while (k > 0 && bound_entry_before(&entry, &list[k - 1]))
+            {
+                list[k] = list[k - 1];
+                k--;
+            }
+            list[k] = entry;
+        }
+    }
+}
+
+// Agenda a operação op do job j, que termina em end_time: retira-a da sua máquina
+// e desloca as cabeças das operações seguintes do mesmo job
+BNB_KERNEL void bound_engine_apply(BoundEngine *engine, int j, int op, int end_time, const Dims d)
+{
+    const int M = d.machines;
+    const int *prefix = &job_prefix_time[j * (M + 1)];
+    int m = job_machine[j * M + op];
+    int pos = bound_engine_find(engine, m, j, op, d);
+    BoundEntry *list = &engine->entries[m * d.stride];
+    for (int i = pos; i + 1 < engine->count[m]; i++)
+    {
+        list[i] = list[i + 1];
+    }
+    engine->count[m]--;
+
+    for (int k = op + 1; k < M; k++)
+    {
+        int mk = job_machine[j * M + k];
+        int new_head = end_time + prefix[k] - prefix[op + 1];
+        bound_engine_move(engine, mk, bound_engine_find(engine, mk, j, k, d), new_head, d);
+    }
+}
+
+// Desfaz bound_engine_apply, repondo as cabeças calculadas a partir do tempo de
+// conclusão anterior do job (previous_completion) e reinserindo a operação
+BNB_KERNEL void bound_engine_undo(BoundEngine *engine, int j, int op, int previous_completion, const Dims d)
+{
+    const int M = d.machines;
+    const int *prefix = &job_prefix_time[j * (M + 1)];
+    for (int k = op + 1; k < M; k++)
+    {
+        int mk = job_machine[j * M + k];
+        int old_head = previous_completion + prefix[k] - prefix[op];
+        bound_engine_move(engine, mk, bound_engine_find(engine, mk, j, k, d), old_head, d);
+    }
+
+    int m = job_machine[j * M + op];
+    BoundEntry *list = &engine->entries[m * d.stride];
+    BoundEntry entry;
+    entry.job = j;
+    entry.op = op;
+    entry.duration = job_duration[j * M + op];
+    entry.head = previous_completion;
+
+    int pos = engine->count[m]++;
+    while (pos > 0 && bound_entry_before(&entry, &list[pos - 1]))
+    {
+        list[pos] = list[pos - 1];
+        pos--;
+    }
+    list[pos] = entry;
+}
+
+// Relaxação de uma máquina (1|r_j,pmtn,q_j|Cmax): escalona preemptivamente as operações
+// restantes da máquina m dando sempre prioridade à de maior cauda (regra de Jackson).
+// O valor devolvido, max(C_i + q_i), é o ótimo da relaxação e um lower bound do makespan.
+BNB_KERNEL int calculate_jackson_machine_bound(BoundEngine *engine, int m, int machine_completion[], const Dims d)
+{
+    const BoundEntry *list = &engine->entries[m * d.stride];
+    int count = engine->count[m];
+    int remaining[d.stride]; // Tempo de processamento ainda por fazer
+    int tail[d.stride];      // Trabalho do job depois da operação
+    int ready[d.stride];     // Índices das operações já libertadas
+    int num_ready = 0;
+    int next = 0;
+    int bound = 0;
+    int current_time = machine_completion[m];
+
+    // As cabeças são limitadas inferiormente pelo tempo em que a máquina fica livre,
+    // o que não altera a ordem da lista
+    while (next < count || num_ready > 0)
+    {
+        if (num_ready == 0)
+        {
+            int release = list[next].head > machine_completion[m] ? list[next].head : machine_completion[m];
+            if (release > current_time)
+                current_time = release;
+        }
+
+        // Liberta todas as operações cuja cabeça já foi atingida
+        while (next < count && list[next].head <= current_time)
+        {
+            remaining[next] = list[next].duration;
+            tail[next] = job_remaining_time[list[next].job * (d.machines + 1) + list[next].op + 1];
+            ready[num_ready++] = next;
+            next++;
+        }
+
+        // Escolhe a operação libertada com maior cauda
+        int best = 0;
+        for (int r = 1; r < num_ready; r++)
+        {
+            if (tail[ready[r]] > tail[ready[best]])
+                best = r;
+        }
+        int i = ready[best];
+
+        // Processa até terminar ou até à próxima libertação (possível preempção)
+        int run = remaining[i];
+        if (next < count && list[next].head - current_time < run)
+            run = list[next].head - current_time;
+        current_time += run;
+        remaining[i] -= run;
+
+        if (remaining[i] == 0)
+        {
+            if (current_time + tail[i] > bound)
+                bound = current_time + tail[i];
+            ready[best] = ready[--num_ready];
+        }
+    }
+
+    return bound;
+}
+
+// Bound por job de um estado e de um lote de count filhos: o termo do job j é
+// job_completion[j] + tempo restante a partir da próxima operação, e o bound é o maior
+// termo. O filho c agenda a próxima operação do job batch_jobs[c], cujo termo passa a
+// batch_own[c]; os termos dos outros jobs não mudam. Escreve os bounds dos filhos em
+// batch_bounds e devolve o do próprio estado.
+typedef int (*JobBoundKernel)(BoundEngine *engine, const int *job_completion, const int *job_next_op, int count, int jobs, int machines);
+
+int job_bound_scalar(BoundEngine *engine, const int *job_completion, const int *job_next_op, int count, int jobs, int machines)
+{
+    int *terms = engine->job_terms;
+    int stride = machines + 1;
+    int node_bound = 0;
+    for (int j = 0; j < jobs; j++)
+    {
+        terms[j] = job_completion[j] + job_remaining_time[j * stride + job_next_op[j]];
+        if (terms[j] > node_bound)
+            node_bound = terms[j];
+    }
+
+    for (int c = 0; c < count; c++)
+    {
+        int skip = engine->batch_jobs[c];
+        int bound = engine->batch_own[c];
+        for (int j = 0; j < jobs; j++)
+        {
+            if (j != skip && terms[j] > bound)
+                bound = terms[j];
+        }
+        engine->batch_bounds[c] = bound;
+    }
+    return node_bound;
+}
+
+#ifdef HAVE_AVX2_KERNEL
+// Máximo dos 8 inteiros de um registo
+__attribute__((target("avx2"))) static inline int max_lanes_avx2(__m256i v)
+{
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+// Mesmo cálculo com 8 jobs por instrução: os tempos restantes são lidos com gather e,
+// em cada filho, a lane do job agendado é anulada antes da redução do máximo (os
+// termos nunca são negativos, por isso 0 é neutro, tal como o preenchimento de job_terms)
+__attribute__((target("avx2"))) int job_bound_avx2(BoundEngine *engine, const int *job_completion, const int *job_next_op, int count, int jobs, int machines)
+{
+    int *terms = engine->job_terms;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i stride = _mm256_set1_epi32(machines + 1);
+    __m256i node_max = _mm256_setzero_si256();
+    int j = 0;
+    for (; j + BOUND_LANES <= jobs; j += BOUND_LANES)
+    {
+        __m256i rows = _mm256_mullo_epi32(_mm256_add_epi32(lanes, _mm256_set1_epi32(j)), stride);
+        __m256i index = _mm256_add_epi32(rows, _mm256_loadu_si256((const __m256i *)&job_next_op[j]));
+        __m256i remaining = _mm256_i32gather_epi32(job_remaining_time, index, 4);
+        __m256i term = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)&job_completion[j]), remaining);
+        _mm256_storeu_si256((__m256i *)&terms[j], term);
+        node_max = _mm256_max_epi32(node_max, term);
+    }
+    int node_bound = max_lanes_avx2(node_max);
+    for (; j < jobs; j++)
+    {
+        terms[j] = job_completion[j] + job_remaining_time[j * (machines + 1) + job_next_op[j]];
+        if (terms[j] > node_bound)
+            node_bound = terms[j];
+    }
+
+    int padded_jobs = (jobs + BOUND_LANES - 1) / BOUND_LANES * BOUND_LANES;
+    for (int c = 0; c < count; c++)
+    {
+        __m256i skip = _mm256_set1_epi32(engine->batch_jobs[c]);
+        __m256i best = _mm256_set1_epi32(engine->batch_own[c]);
+        for (int k = 0; k < padded_jobs; k += BOUND_LANES)
+        {
+            __m256i mask = _mm256_cmpeq_epi32(_mm256_add_epi32(lanes, _mm256_set1_epi32(k)), skip);
+            __m256i term = _mm256_loadu_si256((const __m256i *)&terms[k]);
+            best = _mm256_max_epi32(best, _mm256_andnot_si256(mask, term));
+        }
+        engine->batch_bounds[c] = max_lanes_avx2(best);
+    }
+    return node_bound;
+}
+#endif
+
+// Núcleo do bound por job escolhido em select_bound_kernel
+#define SIMD_AUTO 0
+#define SIMD_SCALAR 1
+#define SIMD_AVX2 2
+int simd_type = SIMD_AUTO;
+long long bench_evaluations = 0; // --bench-bound: avaliações do microbenchmark (0 = busca normal)
+JobBoundKernel job_bound_kernel = job_bound_scalar;
+const char *bound_kernel_name = "escalar";
+
+// Devolve 1 se o processador suporta AVX2 (CPUID)
+int cpu_has_avx2()
+{
+#ifdef HAVE_AVX2_KERNEL
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+void select_bound_kernel()
+{
+    job_bound_kernel = job_bound_scalar;
+    bound_kernel_name = "escalar";
+    if (simd_type == SIMD_SCALAR)
+        return;
+#ifdef HAVE_AVX2_KERNEL
+    if (cpu_has_avx2())
+    {
+        job_bound_kernel = job_bound_avx2;
+        bound_kernel_name = "avx2";
+        return;
+    }
+#endif
+    if (simd_type == SIMD_AVX2)
+    {
+        printf("ERRO: --simd=avx2 pedido, mas o processador nao suporta AVX2\n");
+        exit(1);
+    }
+}
+
+// Mede um núcleo do bound por job sobre os estados do microbenchmark; devolve os
+// segundos gastos e acumula em checksum os bounds, para o cálculo não ser eliminado
+double time_job_bound_kernel(JobBoundKernel kernel, BoundEngine *engine, const int *states, int *batch_jobs,
+                             int *batch_own, const int *batch_count, long long evaluations, long long *checksum)
+{
+    int state_ints = 2 * num_jobs;
+    double start = getClock();
+    for (long long r = 0; r < evaluations; r++)
+    {
+        int k = (int)(r % BENCH_STATES);
+        const int *state = &states[k * state_ints];
+        engine->batch_jobs = &batch_jobs[k * num_jobs];
+        engine->batch_own = &batch_own[k * num_jobs];
+        *checksum += kernel(engine, state, state + num_jobs, batch_count[k], num_jobs, num_machines);
+        for (int c = 0; c < batch_count[k]; c++)
+            *checksum += engine->batch_bounds[c];
+    }
+    return getClock() - start;
+}
+
+// Microbenchmark do bound por job (--bench-bound): estados aleatórios alcançáveis,
+// obtidos aplicando prefixos de escalonamentos aleatórios, com o lote de todos os seus
+// filhos. Confirma que os núcleos dão os mesmos bounds e compara os tempos.
+void run_bound_benchmark(long long evaluations)
+{
+    int state_ints = 2 * num_jobs; // job_completion seguido de job_next_op
+    int *states = (int *)checked_malloc(sizeof(int) * BENCH_STATES * state_ints, "o microbenchmark");
+    int *batch_jobs = (int *)checked_malloc(sizeof(int) * BENCH_STATES * num_jobs, "o microbenchmark");
+    int *batch_own = (int *)checked_malloc(sizeof(int) * BENCH_STATES * num_jobs, "o microbenchmark");
+    int *batch_count = (int *)checked_malloc(sizeof(int) * BENCH_STATES, "o microbenchmark");
+    int *machine_completion = (int *)checked_malloc(sizeof(int) * num_machines, "o microbenchmark");
+    long long total_children = 0;
+    unsigned long long seed = 12345;
+
+    for (int k = 0; k < BENCH_STATES; k++)
+    {
+        int *job_completion = &states[k * state_ints];
+        int *job_next_op = job_completion + num_jobs;
+        for (int j = 0; j < num_jobs; j++)
+        {
+            job_completion[j] = 0;
+            job_next_op[j] = 0;
+        }
+        for (int m = 0; m < num_machines; m++)
+            machine_completion[m] = 0;
+
+        int depth = (int)(splitmix64(&seed) % (unsigned long long)num_ops);
+        for (int step = 0; step < depth; step++)
+        {
+            int j = (int)(splitmix64(&seed) % (unsigned long long)num_jobs);
+            while (job_next_op[j] >= num_machines)
+                j = (j + 1) % num_jobs;
+            int op = job_next_op[j];
+            int machine = job_machine[j * num_machines + op];
+            int start = (job_completion[j] > machine_completion[machine]) ? job_completion[j] : machine_completion[machine];
+            job_completion[j] = start + job_duration[j * num_machines + op];
+            machine_completion[machine] = job_completion[j];
+            job_next_op[j]++;
+        }
+
+        int count = 0;
+        for (int j = 0; j < num_jobs; j++)
+        {
+            int op = job_next_op[j];
+            if (op >= num_machines)
+                continue;
+            int machine = job_machine[j * num_machines + op];
+            int start = (job_completion[j] > machine_completion[machine]) ? job_completion[j] : machine_completion[machine];
+            batch_jobs[k * num_jobs + count] = j;
+            batch_own[k * num_jobs + count] = start + job_remaining_time[j * (num_machines + 1) + op];
+            count++;
+        }
+        batch_count[k] = count;
+        total_children += count;
+    }
+
+    BoundEngine scalar_engine, avx2_engine;
+    bound_engine_alloc(&scalar_engine);
+    bound_engine_alloc(&avx2_engine);
+    // Os lotes são lidos diretamente dos vetores do microbenchmark
+    int *engine_batch_jobs[2] = {scalar_engine.batch_jobs, avx2_engine.batch_jobs};
+    int *engine_batch_own[2] = {scalar_engine.batch_own, avx2_engine.batch_own};
+    long long scalar_checksum = 0;
+    double scalar_time = time_job_bound_kernel(job_bound_scalar, &scalar_engine, states, batch_jobs, batch_own,
+                                               batch_count, evaluations, &scalar_checksum);
+    double children = (double)total_children / BENCH_STATES * evaluations;
+
+    printf("=== MICROBENCHMARK DO BOUND POR JOB ===\n");
+    printf("Instancia: %d jobs x %d maquinas, %d estados, %lld avaliacoes (%.1f filhos por no)\n",
+           num_jobs, num_machines, BENCH_STATES, evaluations, (double)total_children / BENCH_STATES);
+    printf("Escalar: %.4f segundos, %.1f ns por no, %.2f ns por filho\n",
+           scalar_time, scalar_time * 1e9 / evaluations, children > 0 ? scalar_time * 1e9 / children : 0.0);
+
+#ifdef HAVE_AVX2_KERNEL
+    if (cpu_has_avx2())
+    {
+        // Os dois núcleos têm de dar exatamente os mesmos bounds
+        for (int k = 0; k < BENCH_STATES; k++)
+        {
+            const int *state = &states[k * state_ints];
+            scalar_engine.batch_jobs = avx2_engine.batch_jobs = &batch_jobs[k * num_jobs];
+            scalar_engine.batch_own = avx2_engine.batch_own = &batch_own[k * num_jobs];
+            int scalar_bound = job_bound_scalar(&scalar_engine, state, state + num_jobs, batch_count[k], num_jobs, num_machines);
+            int avx2_bound = job_bound_avx2(&avx2_engine, state, state + num_jobs, batch_count[k], num_jobs, num_machines);
+            int same = (scalar_bound == avx2_bound);
+            for (int c = 0; c < batch_count[k]; c++)
+                same = same && scalar_engine.batch_bounds[c] == avx2_engine.batch_bounds[c];
+            if (!same)
+            {
+                printf("ERRO: Os nucleos escalar e AVX2 dao bounds diferentes no estado %d\n", k);
+                exit(1);
+            }
+        }
+
+        long long avx2_checksum = 0;
+        double avx2_time = time_job_bound_kernel(job_bound_avx2, &avx2_engine, states, batch_jobs, batch_own,
+                                                 batch_count, evaluations, &avx2_checksum);
+        printf("AVX2: %.4f segundos, %.1f ns por no, %.2f ns por filho\n",
+               avx2_time, avx2_time * 1e9 / evaluations, children > 0 ? avx2_time * 1e9 / children : 0.0);
+        printf("Aceleracao AVX2: %.2fx (bounds iguais: %s)\n", avx2_time > 0 ? scalar_time / avx2_time : 0.0,
+               scalar_checksum == avx2_checksum ? "sim" : "nao");
+    }
+    else
+#endif
+    {
+        printf("AVX2: nao suportado neste processador\n");
+    }
+
+    scalar_engine.batch_jobs = engine_batch_jobs[0];
+    scalar_engine.batch_own = engine_batch_own[0];
+    avx2_engine.batch_jobs = engine_batch_jobs[1];
+    avx2_engine.batch_own = engine_batch_own[1];
+    bound_engine_free(&scalar_engine);
+    bound_engine_free(&avx2_engine);
+    free(states);
+    free(batch_jobs);
+    free(batch_own);
+    free(batch_count);
+    free(machine_completion);
+}
+
+// job_bound é o bound por job do estado já calculado no lote do pai, ou -1 para o calcular
+BNB_KERNEL int calculate_improved_lower_bound(BoundEngine *engine, int job_bound, int job_completion[], int machine_completion[], int job_next_op[], const Dims d)
+{
+    int max_bound = job_bound;
+    if (max_bound < 0)
+        max_bound = job_bound_kernel(engine, job_completion, job_next_op, 0, d.jobs, d.machines);
+
+    if (bound_type == BOUND_JACKSON)
+    {
+        for (int m = 0; m < d.machines; m++)
+        {
+            int machine_bound = calculate_jackson_machine_bound(engine, m, machine_completion, d);
+            if (machine_bound > max_bound)
+                max_bound = machine_bound;
+        }
+        return max_bound;
+    }
+
+    // Para cada máquina, simula o processamento das operações restantes pela ordem
+    // do tempo mais cedo de início, já mantida pelo motor incremental
+    for (int m = 0; m < d.machines; m++)
+    {
+        const BoundEntry *list = &engine->entries[m * d.stride];
+        int current_time = machine_completion[m];
+        for (int i = 0; i < engine->count[m]; i++)
+        {
+            if (list[i].head > current_time)
+            {
+                current_time = list[i].head;
+            }
+            current_time += list[i].duration;
+        }
+
+        // Atualiza o bound máximo se necessário
+        if (current_time > max_bound)
+            max_bound = current_time;
+    }
+
+    return max_bound; // Retorna o melhor lower bound encontrado
+}
+
+BNB_KERNEL int all_jobs_complete(int job_next_op[], const Dims d)
+{
+    // Verifica se todos os jobs já completaram todas as operações
+    for (int j = 0; j < d.jobs; j++)
+    {
+        if (job_next_op[j] < d.machines)
+            return 0; // Ainda há operações a serem feitas
+    }
+    return 1; // Todos os jobs estão completos
+}
+
+// Makespan do incumbente publicado (leitura relaxada: um valor atrasado só poda menos)
+static inline int load_best_makespan()
+{
+    unsigned long long incumbent;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    incumbent = best_incumbent;
+    int makespan = (int)(incumbent >> 32);
+#ifdef USE_MPI
+    // O incumbente de outro rank também poda, mas o escalonamento fica lá
+    int remote;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    remote = remote_makespan;
+    if (remote < makespan)
+        makespan = remote;
+#endif
+    return makespan;
+}
+
+// Estimativa dos nós explorados por todas as threads, exata para os desta thread
+static inline long long thread_nodes_estimate(const ThreadState *ts)
+{
+    return ts->shared_nodes + (ts->nodes - ts->flushed_nodes);
+}
+
+// Cancela a busca em todas as threads; fica registado o primeiro motivo. As trocas
+// condicionais (aqui e em update_best_solution) usam o builtin atómico, equivalente a
+// omp atomic compare; com o pragma o gcc 12 dá um aviso espúrio de reason sem uso.
+void request_stop(int reason)
+{
+    int expected = STOP_NONE;
+    __atomic_compare_exchange_n(&search_stop, &expected, reason, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+// Verificação barata, feita em cada nó, de um pedido de paragem
+static inline int search_stopped()
+{
+    int stop;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    stop = search_stop;
+    return stop;
+}
+
+// A thread 0 pede um checkpoint quando o intervalo expira; por ser sempre a mesma
+// thread, nunca vê o prazo antigo depois de um checkpoint concluído
+void checkpoint_maybe_request(const ThreadState *ts)
+{
+    if (!checkpoint_filename || ts->id != 0 || getClock() < next_checkpoint_time)
+        return;
+
+    int requested;
+#ifdef _OPENMP
+#pragma omp atomic read seq_cst
+#endif
+    requested = checkpoint_requested;
+    if (requested)
+        return;
+
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+    checkpoint_arrived = 0;
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+    checkpoint_closing = 0;
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+    checkpoint_generation = checkpoint_generation + 1;
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+    checkpoint_requested = 1;
+}
+
+// Soma ao total partilhado os nós contados localmente e refresca a cópia do incumbente
+void flush_thread_counters(ThreadState *ts)
+{
+    // Modo determinístico: os nós são somados por tarefa no fim da ronda e o incumbente
+    // da tarefa não é refrescado; só o limite de tempo é verificado
+    if (deterministic_mode)
+    {
+        ts->flushed_nodes = ts->nodes;
+        if (time_limit > 0 && getClock() >= search_deadline)
+            request_stop(STOP_TIME);
+        return;
+    }
+
+    long long pending = ts->nodes - ts->flushed_nodes;
+    long long total;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+    total = nodes_explored += pending;
+    ts->flushed_nodes = ts->nodes;
+    ts->shared_nodes = total;
+#ifdef USE_MPI
+    if (ts->id == 0)
+        mpi_poll();
+#endif
+    ts->incumbent = load_best_makespan();
+    checkpoint_maybe_request(ts);
+    if (time_limit > 0 && getClock() >= search_deadline)
+        request_stop(STOP_TIME);
+
+    // Regista o progresso a thread cujo lote atravessa um múltiplo de PROGRESS_INTERVAL
+    if (total / PROGRESS_INTERVAL != (total - pending) / PROGRESS_INTERVAL)
+    {
+        LOG(LOG_INFO, "Nos explorados: %lld/%lld, melhor makespan: %d, tempo: %.1fs\n",
+            total, node_limit, ts->incumbent, getClock() - global_start_time);
+    }
+}
+
+// Modo híbrido: o primeiro incumbente encontrado pela busca muda a fase global
+void switch_to_best_first(long long nodes)
+{
+    int previous;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+    {
+        previous = search_phase;
+        search_phase = PHASE_BEST;
+    }
+    if (previous == PHASE_DFS)
+    {
+        phase_switch_time = getClock() - search_start_time;
+        phase_switch_nodes = nodes;
+        LOG(LOG_INFO, "Primeiro incumbente encontrado: busca passa a best-first (nos: %lld)\n", nodes);
+    }
+}
+
+static inline int load_search_phase()
+{
+    int phase;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    phase = search_phase;
+    return phase;
+}
+
+// Acrescenta uma melhoria do incumbente à cronologia (raro, por isso serializado)
+void record_incumbent_event(int makespan, long long nodes)
+{
+    double now = getClock() - search_start_time;
+#ifdef _OPENMP
+#pragma omp critical(incumbent_timeline)
+#endif
+    {
+        if (timeline_size == timeline_capacity)
+        {
+            timeline_capacity = timeline_capacity > 0 ? timeline_capacity * 2 : 16;
+            incumbent_timeline = (IncumbentEvent *)realloc(incumbent_timeline, sizeof(IncumbentEvent) * timeline_capacity);
+            if (!incumbent_timeline)
+            {
+                printf("ERRO: Memoria insuficiente para a cronologia de incumbentes\n");
+                exit(1);
+            }
+        }
+        incumbent_timeline[timeline_size].time = now;
+        incumbent_timeline[timeline_size].makespan = makespan;
+        incumbent_timeline[timeline_size].nodes = nodes;
+        timeline_size++;
+    }
+}
+
+// Publica um escalonamento completo: é copiado para o buffer desta thread que não está
+// publicado e o par (makespan, buffer) substitui o incumbente se for menor
+void update_best_solution(ThreadState *ts, int *schedule, int makespan)
+{
+    // Modo determinístico: a melhoria fica na tarefa e só é publicada no fim da ronda
+    if (deterministic_mode)
+    {
+        if (makespan < ts->incumbent)
+        {
+            memcpy(ts->schedules, schedule, sizeof(int) * num_ops);
+            ts->incumbent = makespan;
+        }
+        return;
+    }
+
+    int buffer = (ts->published_buffer == 0) ? 1 : 0;
+    memcpy(ts->schedules + buffer * num_ops, schedule, sizeof(int) * num_ops);
+
+    unsigned long long candidate = ((unsigned long long)makespan << 32) | (unsigned long long)(ts->id * 2 + buffer);
+    // previous fica com o valor anterior à troca, ou com o atual se não for maior
+    unsigned long long previous = __atomic_load_n(&best_incumbent, __ATOMIC_RELAXED);
+    while (candidate < previous &&
+           !__atomic_compare_exchange_n(&best_incumbent, &previous, candidate, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+
+    int previous_makespan = (int)(previous >> 32);
+    if (candidate < previous)
+        ts->published_buffer = buffer;
+    ts->incumbent = (makespan < previous_makespan) ? makespan : previous_makespan;
+
+    // Verifica se o novo makespan é melhor (menor) que o melhor encontrado até agora
+    if (makespan < previous_makespan)
+    {
+        record_incumbent_event(makespan, thread_nodes_estimate(ts));
+        if (strategy_type == STRATEGY_HYBRID)
+            switch_to_best_first(thread_nodes_estimate(ts));
+#ifdef _OPENMP
+        // Regista a nova melhor solução, incluindo o número da thread
+        LOG(LOG_INFO, "Nova melhor solucao: makespan = %d (thread %d, nos: %lld)\n",
+            makespan, ts->id, thread_nodes_estimate(ts));
+#else
+        // Regista a nova melhor solução (versão sequencial)
+        LOG(LOG_INFO, "Nova melhor solucao: makespan = %d (nos: %lld)\n",
+            makespan, thread_nodes_estimate(ts));
+#endif
+    }
+}
+
+void deque_lock(WorkDeque *dq)
+{
+#ifdef _OPENMP
+    omp_set_lock(&dq->lock);
+#else
+    (void)dq;
+#endif
+}
+
+void deque_unlock(WorkDeque *dq)
+{
+#ifdef _OPENMP
+    omp_unset_lock(&dq->lock);
+#else
+    (void)dq;
+#endif
+}
+
+int deque_size(WorkDeque *dq)
+{
+    int head, tail;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    head = dq->head;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    tail = dq->tail;
+    return tail - head;
+}
+
+// Endereço do bloco do subproblema na posição i do deque
+static inline int *deque_item(WorkDeque *dq, int i)
+{
+    return dq->items + (size_t)i * subproblem_ints;
+}
+
+// Empilha um subproblema no fim do deque; devolve 0 se o deque estiver cheio
+int deque_push(WorkDeque *dq, const int *sp)
+{
+    deque_lock(dq);
+    if (dq->tail == WORK_DEQUE_CAPACITY && dq->head > 0)
+    {
+        // Compacta o deque, movendo os subproblemas para o inicio do vetor
+        int count = dq->tail - dq->head;
+        memmove(deque_item(dq, 0), deque_item(dq, dq->head), sizeof(int) * subproblem_ints * count);
+        dq->head = 0;
+        dq->tail = count;
+    }
+    if (dq->tail == WORK_DEQUE_CAPACITY)
+    {
+        deque_unlock(dq);
+        return 0;
+    }
+
+    // O trabalho pendente e contado antes de ficar visivel para os ladroes
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    outstanding_work++;
+
+    memcpy(deque_item(dq, dq->tail), sp, sizeof(int) * subproblem_ints);
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+    dq->tail = dq->tail + 1;
+    deque_unlock(dq);
+    return 1;
+}
+
+// Retira o subproblema mais recente (usado pelo dono do deque)
+int deque_pop(WorkDeque *dq, int *sp)
+{
+    int found = 0;
+    deque_lock(dq);
+    if (dq->tail > dq->head)
+    {
+        memcpy(sp, deque_item(dq, dq->tail - 1), sizeof(int) * subproblem_ints);
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+        dq->tail = dq->tail - 1;
+        found = 1;
+    }
+    if (dq->tail == dq->head)
+    {
+        dq->head = 0;
+        dq->tail = 0;
+    }
+    deque_unlock(dq);
+    return found;
+}
+
+// Rouba metade (arredondada para cima) dos subproblemas mais antigos da vitima
+// e coloca-os no deque do ladrao; devolve o numero de subproblemas roubados
+int deque_steal_half(WorkDeque *victim, WorkDeque *thief)
+{
+    // Verificacao sem lock para evitar bloquear vitimas sem trabalho
+    if (deque_size(victim) <= 0)
+        return 0;
+
+    deque_lock(victim);
+    int available = victim->tail - victim->head;
+    int count = (available + 1) / 2;
+    if (count <= 0)
+    {
+        deque_unlock(victim);
+        return 0;
+    }
+
+    // O deque do ladrao esta vazio, por isso os subproblemas cabem sempre
+    deque_lock(thief);
+    thief->head = 0;
+    memcpy(deque_item(thief, 0), deque_item(victim, victim->head), sizeof(int) * subproblem_ints * count);
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+    thief->tail = count;
+    deque_unlock(thief);
+
+    victim->head += count;
+    if (victim->head == victim->tail)
+    {
+        victim->head = 0;
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+        victim->tail = 0;
+    }
+    deque_unlock(victim);
+    return count;
+}
+
+void node_pool_init()
+{
+    size_t entry_bytes = sizeof(int) * subproblem_ints + sizeof(int) + sizeof(PoolEntry);
+    long long capacity = pool_memory_mb * 1024 * 1024 / (long long)entry_bytes;
+    if (capacity > INT_MAX)
+        capacity = INT_MAX;
+    if (capacity < 1)
+    {
+        printf("ERRO: Limite de memoria do pool demasiado pequeno: %lld MB\n", pool_memory_mb);
+        exit(1);
+    }
+    node_pool.capacity = (int)capacity;
+    node_pool.blocks = (int *)checked_malloc(sizeof(int) * subproblem_ints * capacity, "o pool de nos");
+    node_pool.free_slots = (int *)checked_malloc(sizeof(int) * capacity, "o pool de nos");
+    node_pool.heap = (PoolEntry *)checked_malloc(sizeof(PoolEntry) * capacity, "o pool de nos");
+    for (int i = 0; i < node_pool.capacity; i++)
+    {
+        node_pool.free_slots[i] = node_pool.capacity - 1 - i;
+    }
+    node_pool.free_count = node_pool.capacity;
+    node_pool.size = 0;
+    node_pool.peak = 0;
+#ifdef _OPENMP
+    omp_init_lock(&node_pool.lock);
+#endif
+}
+
+void node_pool_free()
+{
+    if (!node_pool.blocks)
+        return;
+#ifdef _OPENMP
+    omp_destroy_lock(&node_pool.lock);
+#endif
+    free(node_pool.blocks);
+    free(node_pool.free_slots);
+    free(node_pool.heap);
+    node_pool.blocks = NULL;
+}
+
+static inline int pool_entry_before(const PoolEntry *a, const PoolEntry *b)
+{
+    if (a->bound != b->bound)
+        return a->bound < b->bound;
+    return a->depth > b->depth;
+}
+
+// Guarda um subproblema avaliado; devolve 0 se o pool estiver cheio
+int node_pool_push(const int *sp, int bound, int depth)
+{
+#ifdef _OPENMP
+    omp_set_lock(&node_pool.lock);
+#endif
+    if (node_pool.free_count == 0)
+    {
+#ifdef _OPENMP
+        omp_unset_lock(&node_pool.lock);
+#endif
+        return 0;
+    }
+
+    // O trabalho pendente e contado antes de ficar visivel para as outras threads
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    outstanding_work++;
+
+    int slot = node_pool.free_slots[--node_pool.free_count];
+    memcpy(node_pool.blocks + (size_t)slot * subproblem_ints, sp, sizeof(int) * subproblem_ints);
+
+    PoolEntry entry = {bound, depth, slot};
+    int i = node_pool.size++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!pool_entry_before(&entry, &node_pool.heap[parent]))
+            break;
+        node_pool.heap[i] = node_pool.heap[parent];
+        i = parent;
+    }
+    node_pool.heap[i] = entry;
+    if (node_pool.size > node_pool.peak)
+        node_pool.peak = node_pool.size;
+#ifdef _OPENMP
+    omp_unset_lock(&node_pool.lock);
+#endif
+    return 1;
+}
+
+// Retira o subproblema de menor lower bound; devolve 0 se o pool estiver vazio
+int node_pool_pop(int *sp, int *bound)
+{
+    if (node_pool_size() == 0)
+        return 0;
+
+#ifdef _OPENMP
+    omp_set_lock(&node_pool.lock);
+#endif
+    if (node_pool.size == 0)
+    {
+#ifdef _OPENMP
+        omp_unset_lock(&node_pool.lock);
+#endif
+        return 0;
+    }
+
+    PoolEntry top = node_pool.heap[0];
+    memcpy(sp, node_pool.blocks + (size_t)top.slot * subproblem_ints, sizeof(int) * subproblem_ints);
+    node_pool.free_slots[node_pool.free_count++] = top.slot;
+    *bound = top.bound;
+
+    PoolEntry last = node_pool.heap[--node_pool.size];
+    int i = 0;
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= node_pool.size)
+            break;
+        if (child + 1 < node_pool.size && pool_entry_before(&node_pool.heap[child + 1], &node_pool.heap[child]))
+            child++;
+        if (!pool_entry_before(&node_pool.heap[child], &last))
+            break;
+        node_pool.heap[i] = node_pool.heap[child];
+        i = child;
+    }
+    if (node_pool.size > 0)
+        node_pool.heap[i] = last;
+#ifdef _OPENMP
+    omp_unset_lock(&node_pool.lock);
+#endif
+    return 1;
+}
+
+// Decide se vale a pena dividir a busca atual para alimentar threads ociosas
+int should_split()
+{
+#ifdef USE_MPI
+    // Outro rank pediu trabalho e não havia subproblemas nos deques deste
+    int requested;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    requested = mpi_work_requested;
+#ifdef _OPENMP
+    if (requested && deque_size(&work_deques[omp_get_thread_num()]) == 0)
+        return 1;
+#else
+    if (requested && deque_size(&work_deques[0]) == 0)
+        return 1;
+#endif
+#endif
+#ifdef _OPENMP
+    if (num_workers <= 1)
+        return 0;
+
+    int idle;
+#pragma omp atomic read
+    idle = idle_threads;
+    if (idle == 0)
+        return 0;
+
+    return deque_size(&work_deques[omp_get_thread_num()]) == 0;
+#else
+    return 0;
+#endif
+}
+
+// Tabela de transposição: cada entrada guarda um estado já expandido. A chave Zobrist
+// depende apenas de job_next_op (o conjunto de operações já agendadas); os tempos de
+// conclusão servem para detetar estados iguais ou dominantes. A tabela é partilhada
+// por todas as threads sem locks: cada entrada tem uma versão (seqlock) que é ímpar
+// durante uma escrita, e os leitores descartam cópias cuja versão mudou entretanto.
+// Cada entrada é um cabeçalho seguido de 2J + M inteiros: job_next_op[J],
+// job_completion[J] e machine_completion[M].
+typedef struct
+{
+    unsigned int version; // 0: vazia; par: estável; ímpar: escrita em curso
+    int depth;
+    unsigned long long key;
+} TTHeader;
+
+unsigned char *tt_table = NULL;
+size_t tt_entry_bytes = 0;
+unsigned long long tt_bucket_mask = 0;
+unsigned long long *zobrist_keys = NULL; // zobrist_keys[j * (num_machines + 1) + op]
+
+// Reserva a tabela com o maior número de baldes potência de 2 que cabe no pedido
+void tt_init(long long requested_entries)
+{
+    unsigned long long seed = 0x4A4F4253484F50ULL;
+    zobrist_keys = (unsigned long long *)checked_malloc(sizeof(unsigned long long) * num_jobs * (num_machines + 1), "as chaves Zobrist");
+    for (int i = 0; i < num_jobs * (num_machines + 1); i++)
+    {
+        zobrist_keys[i] = splitmix64(&seed);
+    }
+
+    if (requested_entries < TT_BUCKET_SIZE)
+        return;
+
+    unsigned long long buckets = 1;
+    while (buckets * 2 * TT_BUCKET_SIZE <= (unsigned long long)requested_entries)
+        buckets *= 2;
+
+    tt_entry_bytes = sizeof(TTHeader) + sizeof(int) * (2 * num_jobs + num_machines);
+    tt_entry_bytes = (tt_entry_bytes + 7) & ~(size_t)7;
+    tt_table = (unsigned char *)calloc(buckets * TT_BUCKET_SIZE, tt_entry_bytes);
+    if (!tt_table)
+    {
+        printf("ERRO: Memoria insuficiente para a tabela de transposicao\n");
+        exit(1);
+    }
+    tt_bucket_mask = buckets - 1;
+}
+
+void tt_free()
+{
+    free(tt_table);
+    free(zobrist_keys);
+    tt_table = NULL;
+    zobrist_keys = NULL;
+}
+
+// Esvazia a tabela (todas as versões a 0) entre duas buscas
+void tt_clear()
+{
+    if (tt_table)
+        memset(tt_table, 0, (tt_bucket_mask + 1) * TT_BUCKET_SIZE * tt_entry_bytes);
+    tt_probes = 0;
+    tt_hits = 0;
+    tt_stores = 0;
+    tt_replacements = 0;
+}
+
+long long tt_num_entries()
+{
+    return tt_table ? (long long)(tt_bucket_mask + 1) * TT_BUCKET_SIZE : 0;
+}
+
+// Chave Zobrist de um estado, calculada de raiz (a busca mantém-na incrementalmente)
+unsigned long long tt_state_key(const int job_next_op[])
+{
+    unsigned long long key = 0;
+    for (int j = 0; j < num_jobs; j++)
+    {
+        key ^= zobrist_keys[j * (num_machines + 1) + job_next_op[j]];
+    }
+    return key;
+}
+
+static inline TTHeader *tt_slot(unsigned long long key, int i)
+{
+    return (TTHeader *)(tt_table + ((key & tt_bucket_mask) * TT_BUCKET_SIZE + i) * tt_entry_bytes);
+}
+
+// Copia uma entrada de forma consistente; devolve 0 se estiver vazia ou a ser escrita
+BNB_KERNEL int tt_read_entry(TTHeader *slot, TTHeader *header, int *payload, const Dims d)
+{
+    unsigned int v1 = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+    if (v1 == 0 || (v1 & 1))
+        return 0;
+
+    const int *data = (const int *)(slot + 1);
+    header->key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+    header->depth = __atomic_load_n(&slot->depth, __ATOMIC_RELAXED);
+    for (int i = 0; i < 2 * d.jobs + d.machines; i++)
+    {
+        payload[i] = __atomic_load_n(&data[i], __ATOMIC_RELAXED);
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->version, __ATOMIC_RELAXED) == v1;
+}
+
+// Verifica se a entrada tem as mesmas operações agendadas que o estado
+BNB_KERNEL int tt_same_configuration(const TTHeader *header, const int *payload, unsigned long long key,
+                                     const Subproblem *state, const Dims d)
+{
+    if (header->key != key)
+        return 0;
+    for (int j = 0; j < d.jobs; j++)
+    {
+        if (payload[j] != state->job_next_op[j])
+            return 0;
+    }
+    return 1;
+}
+
+// Verifica se os tempos de conclusão a (jobs seguidos de máquinas) são todos
+// menores ou iguais aos do estado b
+BNB_KERNEL int tt_completions_dominate(const int *a_jobs, const int *a_machines,
+                                       const int *b_jobs, const int *b_machines, const Dims d)
+{
+    for (int j = 0; j < d.jobs; j++)
+    {
+        if (a_jobs[j] > b_jobs[j])
+            return 0;
+    }
+    for (int m = 0; m < d.machines; m++)
+    {
+        if (a_machines[m] > b_machines[m])
+            return 0;
+    }
+    return 1;
+}
+
+// Procura um estado já expandido igual ou dominante: qualquer solução que o estado
+// atual produzisse também é alcançável, com makespan igual ou menor, a partir dele
+BNB_KERNEL int tt_probe(unsigned long long key, const Subproblem *state, const Dims d)
+{
+    TTHeader header;
+    int payload[2 * d.jobs + d.machines];
+    for (int i = 0; i < TT_BUCKET_SIZE; i++)
+    {
+        if (tt_read_entry(tt_slot(key, i), &header, payload, d) &&
+            tt_same_configuration(&header, payload, key, state, d) &&
+            tt_completions_dominate(payload + d.jobs, payload + 2 * d.jobs,
+                                    state->job_completion, state->machine_completion, d))
+            return 1;
+    }
+    return 0;
+}
+
+// Guarda um estado expandido. Substitui, por ordem de preferência, uma entrada da mesma
+// configuração que o estado domina, uma entrada vazia ou a entrada mais profunda do balde.
+// Se a entrada escolhida estiver a ser escrita por outra thread, a escrita é abandonada.
+// Devolve 1 se foi expulso um estado que o novo não domina.
+BNB_KERNEL int tt_store(unsigned long long key, const Subproblem *state, const Dims d)
+{
+    TTHeader header;
+    int payload[2 * d.jobs + d.machines];
+    int target = -1;
+    int deepest = -1;
+    int deepest_depth = -1;
+
+    for (int i = 0; i < TT_BUCKET_SIZE; i++)
+    {
+        TTHeader *slot = tt_slot(key, i);
+        if (!tt_read_entry(slot, &header, payload, d))
+        {
+            if (__atomic_load_n(&slot->version, __ATOMIC_RELAXED) == 0)
+            {
+                target = i;
+                break;
+            }
+            continue;
+        }
+        if (tt_same_configuration(&header, payload, key, state, d) &&
+            tt_completions_dominate(state->job_completion, state->machine_completion,
+                                    payload + d.jobs, payload + 2 * d.jobs, d))
+        {
+            target = i;
+            break;
+        }
+        if (header.depth > deepest_depth)
+        {
+            deepest_depth = header.depth;
+            deepest = i;
+        }
+    }
+
+    int replaced = 0;
+    if (target < 0)
+    {
+        if (deepest < 0)
+            return 0;
+        target = deepest;
+        replaced = 1;
+    }
+
+    TTHeader *slot = tt_slot(key, target);
+    unsigned int version = __atomic_load_n(&slot->version, __ATOMIC_RELAXED);
+    if ((version & 1) ||
+        !__atomic_compare_exchange_n(&slot->version, &version, version + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return 0;
+
+    int *data = (int *)(slot + 1);
+    __atomic_store_n(&slot->key, key, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->depth, *state->depth, __ATOMIC_RELAXED);
+    for (int j = 0; j < d.jobs; j++)
+    {
+        __atomic_store_n(&data[j], state->job_next_op[j], __ATOMIC_RELAXED);
+        __atomic_store_n(&data[d.jobs + j], state->job_completion[j], __ATOMIC_RELAXED);
+    }
+    for (int m = 0; m < d.machines; m++)
+    {
+        __atomic_store_n(&data[2 * d.jobs + m], state->machine_completion[m], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&slot->version, version + 2, __ATOMIC_RELEASE);
+    return replaced;
+}
+
+// Candidato a ramificação: próxima operação de um job disponível
+typedef struct
+{
+    int job;
+    int priority_score;
+    int remaining_time;
+    int duration;
+    int earliest_start;
+    int machine;
+    int op;
+    int job_bound;    // Bound por job do filho, calculado no lote do pai
+    int dominated_by; // Regra de dominância que poda o candidato (-1 se nenhuma)
+    int discrepancy;  // Posição do filho na ordem de prioridade (custo no LDS)
+} JobInfo;
+
+// Registo do trilho de desfazer: valores sobrescritos ao aplicar uma operação
+typedef struct
+{
+    int job;
+    int op;
+    int machine;
+    int previous_job_completion;
+    int previous_machine_completion;
+    int previous_last_job;
+    int discrepancy;
+} UndoRecord;
+
+// Nó aberto na pilha explícita da DFS: filhos já ordenados e o próximo a explorar
+typedef struct
+{
+    JobInfo *children; // num_jobs posições reservadas no contexto
+    int num_children;
+    int next_child;
+    int lower_bound; // Lower bound do nó, válido para toda a sua subárvore
+} SearchFrame;
+
+// Contexto de busca de uma thread: o estado é alterado no lugar e o trilho
+// guarda o necessário para o repor. trail[k] é a operação que liga frames[k] a frames[k + 1].
+typedef struct
+{
+    int *state;         // Bloco do estado atual (subproblem_ints inteiros)
+    int *scratch;       // Blocos auxiliares para materializar subproblemas doados
+    int *scratch_child;
+    BoundEngine engine;
+    UndoRecord *trail;  // num_ops registos
+    int trail_size;
+    SearchFrame *frames; // num_ops + 1 nós abertos
+    JobInfo *children;   // (num_ops + 1) * num_jobs candidatos, repartidos pelos nós
+    unsigned long long *child_keys; // num_jobs chaves para ordenar os filhos de um nó
+    JobInfo *child_sorted;          // num_jobs candidatos já ordenados
+    int num_frames;
+    unsigned long long key; // Chave Zobrist do estado atual
+    long long tt_probes;    // Contadores locais da tabela de transposição
+    long long tt_hits;
+    long long tt_stores;
+    long long tt_replacements;
+    ThreadState *thread;    // Contadores e incumbente privados da thread dona
+    int phase;              // Fase em que esta thread está (PHASE_DFS ou PHASE_BEST)
+} SearchContext;
+
+SearchContext *search_context_create()
+{
+    SearchContext *ctx = (SearchContext *)checked_malloc(sizeof(SearchContext), "o contexto de busca");
+    ctx->state = (int *)checked_malloc(sizeof(int) * subproblem_ints, "o contexto de busca");
+    ctx->scratch = (int *)checked_malloc(sizeof(int) * subproblem_ints, "o contexto de busca");
+    ctx->scratch_child = (int *)checked_malloc(sizeof(int) * subproblem_ints, "o contexto de busca");
+    bound_engine_alloc(&ctx->engine);
+    ctx->trail = (UndoRecord *)checked_malloc(sizeof(UndoRecord) * num_ops, "o contexto de busca");
+    ctx->frames = (SearchFrame *)checked_malloc(sizeof(SearchFrame) * (num_ops + 1), "o contexto de busca");
+    ctx->children = (JobInfo *)checked_malloc(sizeof(JobInfo) * (num_ops + 1) * num_jobs, "o contexto de busca");
+    ctx->child_keys = (unsigned long long *)checked_malloc(sizeof(unsigned long long) * num_jobs, "o contexto de busca");
+    ctx->child_sorted = (JobInfo *)checked_malloc(sizeof(JobInfo) * num_jobs, "o contexto de busca");
+    for (int f = 0; f <= num_ops; f++)
+    {
+        ctx->frames[f].children = &ctx->children[f * num_jobs];
+    }
+    ctx->trail_size = 0;
+    ctx->num_frames = 0;
+    ctx->key = 0;
+    ctx->phase = PHASE_DFS;
+    ctx->tt_probes = 0;
+    ctx->tt_hits = 0;
+    ctx->tt_stores = 0;
+    ctx->tt_replacements = 0;
+    return ctx;
+}
+
+void search_context_destroy(SearchContext *ctx)
+{
+    free(ctx->state);
+    free(ctx->scratch);
+    free(ctx->scratch_child);
+    bound_engine_free(&ctx->engine);
+    free(ctx->trail);
+    free(ctx->frames);
+    free(ctx->children);
+    free(ctx->child_keys);
+    free(ctx->child_sorted);
+    free(ctx);
+}
+
+// Aplica a operação do candidato ao estado e devolve o registo para a desfazer
+BNB_KERNEL UndoRecord apply_operation(Subproblem *state, const JobInfo *cand, const Dims d)
+{
+    UndoRecord record;
+    record.job = cand->job;
+    record.op = cand->op;
+    record.machine = cand->machine;
+    record.previous_job_completion = state->job_completion[cand->job];
+    record.previous_machine_completion = state->machine_completion[cand->machine];
+    record.previous_last_job = *state->last_job;
+    record.discrepancy = cand->discrepancy;
+
+    int end_time = cand->earliest_start + cand->duration;
+    state->schedule[cand->job * d.machines + cand->op] = cand->earliest_start;
+    state->job_completion[cand->job] = end_time;
+    state->machine_completion[cand->machine] = end_time;
+    state->job_next_op[cand->job]++;
+    (*state->depth)++;
+    *state->discrepancies += cand->discrepancy;
+    *state->last_job = cand->job;
+    return record;
+}
+
+// Repõe os valores guardados no registo
+BNB_KERNEL void undo_operation(Subproblem *state, const UndoRecord *record, const Dims d)
+{
+    state->schedule[record->job * d.machines + record->op] = -1;
+    state->job_completion[record->job] = record->previous_job_completion;
+    state->machine_completion[record->machine] = record->previous_machine_completion;
+    state->job_next_op[record->job]--;
+    (*state->depth)--;
+    *state->discrepancies -= record->discrepancy;
+    *state->last_job = record->previous_last_job;
+}
+
+// Avança para um filho: altera o estado no lugar e atualiza o motor do lower bound
+BNB_KERNEL void make_move(SearchContext *ctx, const JobInfo *cand, const Dims d)
+{
+    Subproblem state = subproblem_view(ctx->state, d);
+    const unsigned long long *keys = &zobrist_keys[cand->job * (d.machines + 1)];
+    ctx->key ^= keys[cand->op] ^ keys[cand->op + 1];
+    ctx->trail[ctx->trail_size++] = apply_operation(&state, cand, d);
+    bound_engine_apply(&ctx->engine, cand->job, cand->op, state.job_completion[cand->job], d);
+}
+
+// Retrocede a última operação aplicada
+BNB_KERNEL void unmake_move(SearchContext *ctx, const Dims d)
+{
+    Subproblem state = subproblem_view(ctx->state, d);
+    const UndoRecord *record = &ctx->trail[--ctx->trail_size];
+    const unsigned long long *keys = &zobrist_keys[record->job * (d.machines + 1)];
+    bound_engine_undo(&ctx->engine, record->job, record->op, record->previous_job_completion, d);
+    undo_operation(&state, record, d);
+    ctx->key ^= keys[record->op] ^ keys[record->op + 1];
+}
+
+// Avalia o nó correspondente ao estado atual: conta-o, trata as folhas e as podas por
+// transposição e por bound. job_bound é o bound por job vindo do lote do pai (-1 se o nó
+// não foi gerado por generate_children). Devolve o lower bound do nó, ou -1 se o nó ficou fechado.
+BNB_KERNEL int evaluate_node(SearchContext *ctx, int job_bound, const Dims d)
+{
+    const int J = d.jobs;
+    const int M = d.machines;
+    Subproblem view = subproblem_view(ctx->state, d);
+    Subproblem *state = &view;
+    int *job_completion = state->job_completion;
+    int *machine_completion = state->machine_completion;
+    int *job_next_op = state->job_next_op;
+    int depth = *state->depth;
+    ThreadState *ts = ctx->thread;
+
+    // Modo determinístico: esgotado o orçamento da tarefa, o nó fica por explorar
+    if (ts->nodes >= ts->task_node_cap)
+    {
+        ts->task_suspended = 1;
+        return -1;
+    }
+
+    // Esgotado o orçamento de nós, cancela a busca em todas as threads
+    if (thread_nodes_estimate(ts) >= node_limit)
+    {
+        request_stop(STOP_NODES);
+        return -1;
+    }
+
+    // Conta o nó no contador privado; o total partilhado só é atualizado por lotes
+    ts->nodes++;
+    if (ts->nodes - ts->flushed_nodes >= NODE_FLUSH_INTERVAL)
+        flush_thread_counters(ts);
+    PROFILE(profile_count(ts->profile, depth, PROFILE_NODES, 1);)
+
+    // Se todos os jobs estão completos, verifica e atualiza a melhor solução
+    if (all_jobs_complete(job_next_op, d))
+    {
+        int makespan = 0;
+        for (int j = 0; j < J; j++)
+        {
+            if (job_completion[j] > makespan)
+                makespan = job_completion[j];
+        }
+
+        if (!deterministic_mode)
+            LOG(LOG_DEBUG, "Solucao completa encontrada: makespan = %d (nos: %lld)\n", makespan, thread_nodes_estimate(ts));
+        update_best_solution(ts, state->schedule, makespan);
+        return -1;
+    }
+
+    // Limita a profundidade máxima da busca para evitar loops infinitos
+    int max_reasonable_depth = J * M;
+    if (depth > max_reasonable_depth)
+    {
+        PROFILE(profile_count(ts->profile, depth, PROFILE_PRUNE_DEPTH, 1);)
+        return -1;
+    }
+
+    // Poda por transposição: um estado igual ou dominante já foi expandido
+    if (tt_table)
+    {
+        ctx->tt_probes++;
+        if (tt_probe(ctx->key, state, d))
+        {
+            ctx->tt_hits++;
+            PROFILE(profile_count(ts->profile, depth, PROFILE_PRUNE_TRANSPOSITION, 1);)
+            return -1;
+        }
+    }
+
+    // Calcula um lower bound para o makespan a partir do estado atual
+    PROFILE(unsigned long long bound_start = profile_cycles();)
+    int lower_bound = calculate_improved_lower_bound(&ctx->engine, job_bound, job_completion, machine_completion, job_next_op, d);
+    PROFILE(profile_add_cycles(ts->profile, PROFILE_BOUNDING, bound_start);)
+    PROFILE(profile_bound(ts->profile, lower_bound, ts->incumbent);)
+    if (lower_bound >= ts->incumbent)
+    {
+        // Poda: não vale a pena explorar este ramo
+        PROFILE(profile_count(ts->profile, depth, PROFILE_PRUNE_BOUND, 1);)
+        return -1;
+    }
+
+    // O estado vai ser expandido: fica registado para podar as suas transposições
+    if (tt_table)
+    {
+        ctx->tt_stores++;
+        ctx->tt_replacements += tt_store(ctx->key, state, d);
+    }
+    return lower_bound;
+}
+
+// Regras de dominância sobre os candidatos do nó atual; devolve quantos ficam. Nenhuma
+// poda a ordem de agendamento lexicograficamente menor (por índice de job) de um
+// escalonamento ativo, e há sempre um escalonamento ótimo ativo: a busca continua exata.
+// - Comutação: dois passos seguidos em jobs e máquinas diferentes dão o mesmo
+//   escalonamento pelas duas ordens, por isso só se segue a que agenda primeiro o job
+//   de menor índice. O passo anterior é o last_job do estado, que viaja no bloco de
+//   um subproblema doado, tirado do pool ou retomado de um checkpoint.
+// - Tempo ocioso: se outra operação disponível na mesma máquina termina antes de o
+//   candidato poder começar, cabe no intervalo em que a máquina ficaria parada e o
+//   escalonamento resultante não seria ativo. Terminar no instante em que o candidato
+//   começa também conta, exceto entre duas operações de duração 0 com o mesmo início:
+//   aí cada uma dominaria a outra e só a de menor índice pode podar.
+BNB_KERNEL int prune_dominated_children(SearchContext *ctx, JobInfo *cands, int count, const Dims d)
+{
+    int last_job = -1;
+    int last_machine = -1;
+    if (dominance_mask & (1 << DOMINANCE_COMMUTE))
+    {
+        Subproblem state = subproblem_view(ctx->state, d);
+        last_job = *state.last_job;
+        if (last_job >= 0)
+            last_machine = job_machine[last_job * d.machines + state.job_next_op[last_job] - 1];
+    }
+
+    // As marcas vêm primeiro: a regra do tempo ocioso compara com todos os candidatos
+    for (int i = 0; i < count; i++)
+    {
+        JobInfo *cand = &cands[i];
+        cand->dominated_by = -1;
+        if (last_job >= 0 && cand->job < last_job && cand->machine != last_machine)
+        {
+            cand->dominated_by = DOMINANCE_COMMUTE;
+            continue;
+        }
+        if (dominance_mask & (1 << DOMINANCE_IDLE))
+        {
+            for (int k = 0; k < count; k++)
+            {
+                if (k == i || cands[k].machine != cand->machine)
+                    continue;
+                int completion = cands[k].earliest_start + cands[k].duration;
+                if (completion < cand->earliest_start ||
+                    (completion == cand->earliest_start && (cands[k].duration > 0 || cand->duration > 0 || k < i)))
+                {
+                    cand->dominated_by = DOMINANCE_IDLE;
+                    break;
+                }
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (cands[i].dominated_by >= 0)
+            ctx->thread->dominance_prunes[cands[i].dominated_by]++;
+        else
+            cands[kept++] = cands[i];
+    }
+    return kept;
+}
+
+// Chave de ordenação de um filho: prioridade invertida na metade alta (ordem crescente
+// = maior score primeiro) e posição original na metade baixa
+static inline unsigned long long child_order_key(const JobInfo *child, int position)
+{
+    return ((unsigned long long)(unsigned)(INT_MAX - child->priority_score) << 32) | (unsigned)position;
+}
+
+int compare_child_keys(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Ordena os filhos por prioridade decrescente com o resultado exato da ordenação por
+// seleção original, para que as contagens de nós se mantenham comparáveis. Sem
+// empates qualquer ordenação dá a mesma ordem e basta O(n log n); a ordenação por
+// seleção troca elementos empatados de forma não estável, por isso só com empates se
+// repete esse procedimento, sobre as chaves e não sobre os candidatos.
+BNB_KERNEL void order_children(SearchContext *ctx, JobInfo *children, int count)
+{
+    unsigned long long *keys = ctx->child_keys;
+    for (int c = 0; c < count; c++)
+    {
+        keys[c] = child_order_key(&children[c], c);
+    }
+    qsort(keys, count, sizeof(unsigned long long), compare_child_keys);
+
+    int ties = 0;
+    for (int c = 1; c < count && !ties; c++)
+    {
+        ties = (keys[c] >> 32) == (keys[c - 1] >> 32);
+    }
+    if (ties)
+    {
+        for (int c = 0; c < count; c++)
+        {
+            keys[c] = child_order_key(&children[c], c);
+        }
+        for (int i = 0; i < count - 1; i++)
+        {
+            for (int k = i + 1; k < count; k++)
+            {
+                if ((keys[k] >> 32) < (keys[i] >> 32))
+                {
+                    unsigned long long temp = keys[i];
+                    keys[i] = keys[k];
+                    keys[k] = temp;
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < count; c++)
+    {
+        ctx->child_sorted[c] = children[keys[c] & 0xFFFFFFFFu];
+    }
+    memcpy(children, ctx->child_sorted, sizeof(JobInfo) * count);
+}
+
+// Largura do feixe na profundidade dada (0 = sem limite)
+static inline int beam_width_at(int depth)
+{
+    for (int i = 0; i < beam_levels - 1; i++)
+    {
+        if (depth < beam_depths[i])
+            return beam_widths[i];
+    }
+    return beam_widths[beam_levels - 1];
+}
+
+// Filhos a explorar de um nó à profundidade dada, com discrepancies já gastas no caminho
+BNB_KERNEL int branch_limit(int depth, int discrepancies, int num_available)
+{
+    if (search_mode == SEARCH_EXACT)
+        return num_available;
+
+    int limit = num_available;
+    int width = beam_width_at(depth);
+    if (width > 0 && width < limit)
+        limit = width;
+    if (search_mode == SEARCH_LDS && lds_max_discrepancies - discrepancies + 1 < limit)
+        limit = lds_max_discrepancies - discrepancies + 1;
+    return limit;
+}
+
+// Gera em frame os filhos do nó do estado atual, já avaliado com lower_bound, pela
+// ordem em que devem ser explorados. Devolve 1 se houver algum filho.
+BNB_KERNEL int generate_children(SearchContext *ctx, SearchFrame *frame, int lower_bound, const Dims d)
+{
+    const int J = d.jobs;
+    const int M = d.machines;
+    int *job_completion = ctx->state + J * M;
+    int *machine_completion = job_completion + J;
+    int *job_next_op = machine_completion + M;
+    int depth = job_next_op[J];
+    ThreadState *ts = ctx->thread;
+    PROFILE(unsigned long long branch_start = profile_cycles();)
+
+    JobInfo *available_jobs = frame->children;
+    int num_available = 0;
+
+    // Identifica todos os jobs que ainda têm operações a serem agendadas
+    for (int j = 0; j < J; j++)
+    {
+        if (job_next_op[j] < M)
+        {
+            int op = job_next_op[j];
+            int machine = job_machine[j * M + op];
+            int duration = job_duration[j * M + op];
+            int earliest_start = (job_completion[j] > machine_completion[machine]) ? job_completion[j] : machine_completion[machine];
+
+            available_jobs[num_available].job = j;
+            available_jobs[num_available].remaining_time = job_remaining_time[j * (M + 1) + op];
+            available_jobs[num_available].duration = duration;
+            available_jobs[num_available].earliest_start = earliest_start;
+            available_jobs[num_available].machine = machine;
+            available_jobs[num_available].op = op;
+
+            // Calcula uma prioridade para o job com base em urgência, gargalo e duração.
+            // O gargalo (operações restantes na mesma máquina) é o contador que o motor
+            // do lower bound já mantém ao agendar e desfazer operações.
+            int urgency = job_remaining_time[j * (M + 1) + op];
+            int bottleneck = ctx->engine.count[machine];
+
+            available_jobs[num_available].priority_score = urgency * 100 + bottleneck * 20 + duration * 5;
+            num_available++;
+        }
+    }
+
+    // Os candidatos dominados não chegam a ser filhos
+    if (dominance_mask)
+    {
+        PROFILE(int before_dominance = num_available;)
+        num_available = prune_dominated_children(ctx, available_jobs, num_available, d);
+        PROFILE(profile_count(ts->profile, depth + 1, PROFILE_PRUNE_DOMINANCE, before_dominance - num_available);)
+    }
+
+    // Giffler-Thompson: a operação disponível que termina mais cedo define a máquina
+    // em conflito; só se ramifica nas operações dessa máquina que podem começar antes
+    // desse instante, o que gera apenas escalonamentos ativos. A operação que define o
+    // instante entra sempre: com duração 0 começa nele e o conjunto ficaria vazio.
+    if (branching_type == BRANCHING_ACTIVE && num_available > 0)
+    {
+        int min_completion = INT_MAX;
+        int min_index = -1;
+        int conflict_machine = -1;
+        for (int i = 0; i < num_available; i++)
+        {
+            int completion = available_jobs[i].earliest_start + available_jobs[i].duration;
+            if (completion < min_completion)
+            {
+                min_completion = completion;
+                min_index = i;
+                conflict_machine = available_jobs[i].machine;
+            }
+        }
+
+        int num_conflicts = 0;
+        for (int i = 0; i < num_available; i++)
+        {
+            if (available_jobs[i].machine == conflict_machine &&
+                (available_jobs[i].earliest_start < min_completion || i == min_index))
+            {
+                available_jobs[num_conflicts++] = available_jobs[i];
+            }
+        }
+        num_available = num_conflicts;
+    }
+
+    // Ordena os jobs disponíveis por prioridade (maior score primeiro)
+    order_children(ctx, available_jobs, num_available);
+
+    // Número de ramos a explorar segundo o modo de busca
+    int max_branches = branch_limit(depth, job_next_op[J + 1], num_available);
+    for (int c = 0; c < max_branches; c++)
+    {
+        available_jobs[c].discrepancy = c;
+    }
+
+    // Os filhos cortados nunca serão explorados: o bound do nó limita o que perdem
+    if (max_branches < num_available && lower_bound < ts->truncated_bound)
+        ts->truncated_bound = lower_bound;
+    PROFILE(profile_count(ts->profile, depth + 1, PROFILE_PRUNE_BRANCH_LIMIT, num_available - max_branches);)
+
+    // Bound por job de todos os filhos num só lote sobre o estado do pai
+    BoundEngine *engine = &ctx->engine;
+    for (int c = 0; c < max_branches; c++)
+    {
+        engine->batch_jobs[c] = available_jobs[c].job;
+        engine->batch_own[c] = available_jobs[c].earliest_start + available_jobs[c].remaining_time;
+    }
+    PROFILE(unsigned long long kernel_start = profile_cycles();)
+    job_bound_kernel(engine, job_completion, job_next_op, max_branches, J, M);
+    PROFILE(unsigned long long kernel_cycles = profile_cycles() - kernel_start;)
+    PROFILE(ts->profile[profile_cycles_offset() + PROFILE_BOUNDING] += (long long)kernel_cycles;)
+    PROFILE(branch_start += kernel_cycles;) // O lote de bounds não conta como ramificação
+    for (int c = 0; c < max_branches; c++)
+    {
+        available_jobs[c].job_bound = engine->batch_bounds[c];
+    }
+
+    frame->num_children = max_branches;
+    frame->next_child = 0;
+    frame->lower_bound = lower_bound;
+    PROFILE(profile_add_cycles(ts->profile, PROFILE_BRANCHING, branch_start);)
+    return max_branches > 0;
+}
+
+// Processa o nó correspondente ao estado atual. Devolve 1 se o nó tem filhos a
+// explorar (guardados em frame) e 0 se é uma folha, foi podado ou o limite foi atingido.
+BNB_KERNEL int expand_node(SearchContext *ctx, SearchFrame *frame, int job_bound, const Dims d)
+{
+    int lower_bound = evaluate_node(ctx, job_bound, d);
+    if (lower_bound < 0)
+        return 0;
+    return generate_children(ctx, frame, lower_bound, d);
+}
+
+// Divisão adaptativa: doa os filhos por explorar do nó aberto mais raso (a maior
+// subárvore disponível). O estado desse nó obtém-se desfazendo o trilho numa cópia
+// do estado atual. Do nó do topo guarda-se sempre o próximo filho para a própria thread.
+BNB_KERNEL void donate_open_nodes(SearchContext *ctx, const Dims d)
+{
+#ifdef _OPENMP
+    WorkDeque *own = &work_deques[omp_get_thread_num()];
+#else
+    WorkDeque *own = &work_deques[0];
+#endif
+    int top = ctx->num_frames - 1;
+
+    for (int f = 0; f <= top; f++)
+    {
+        SearchFrame *frame = &ctx->frames[f];
+        int keep = (f == top) ? 1 : 0;
+        if (frame->num_children - frame->next_child - keep <= 0)
+            continue;
+
+        // Subárvores pequenas não compensam o custo da doação
+        int depth = *subproblem_view(ctx->state, d).depth - (top - f);
+        if (d.jobs * d.machines - depth < SPLIT_MIN_REMAINING_OPS)
+            return;
+
+        memcpy(ctx->scratch, ctx->state, sizeof(int) * subproblem_ints);
+        Subproblem base = subproblem_view(ctx->scratch, d);
+        for (int k = ctx->trail_size - 1; k >= f; k--)
+        {
+            undo_operation(&base, &ctx->trail[k], d);
+        }
+
+        // Empilhados do último para o primeiro, para que o dono continue pela ordem
+        // de prioridade e os ladrões levem os de menor prioridade
+        int first = frame->next_child + keep;
+        int donated_from = frame->num_children;
+        for (int k = frame->num_children - 1; k >= first; k--)
+        {
+            memcpy(ctx->scratch_child, ctx->scratch, sizeof(int) * subproblem_ints);
+            Subproblem child = subproblem_view(ctx->scratch_child, d);
+            apply_operation(&child, &frame->children[k], d);
+            if (!deque_push(own, ctx->scratch_child))
+                break;
+            donated_from = k;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+            subproblems_donated++;
+        }
+        frame->num_children = donated_from;
+        return;
+    }
+}
+
+// Soma de verificação da instância guardada no checkpoint (FNV-1a)
+unsigned long long instance_hash()
+{
+    unsigned long long hash = 1469598103934665603ULL;
+    for (int k = 0; k < num_ops; k++)
+    {
+        hash = (hash ^ (unsigned long long)job_machine[k]) * 1099511628211ULL;
+        hash = (hash ^ (unsigned long long)job_duration[k]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Bytes por índice de job nos registos (1 chega para as instâncias habituais)
+static inline int checkpoint_job_bytes()
+{
+    return num_jobs <= 256 ? 1 : 2;
+}
+
+void checkpoint_reserve(CheckpointBuffer *buf, size_t extra)
+{
+    if (buf->size + extra <= buf->capacity)
+        return;
+    size_t capacity = buf->capacity > 0 ? buf->capacity : 4096;
+    while (capacity < buf->size + extra)
+        capacity *= 2;
+    unsigned char *data = (unsigned char *)realloc(buf->data, capacity);
+    if (!data)
+    {
+        printf("ERRO: Memoria insuficiente para o checkpoint\n");
+        exit(1);
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+}
+
+void checkpoint_put_bytes(CheckpointBuffer *buf, const void *bytes, size_t count)
+{
+    checkpoint_reserve(buf, count);
+    memcpy(buf->data + buf->size, bytes, count);
+    buf->size += count;
+}
+
+void checkpoint_put_u16(CheckpointBuffer *buf, int value)
+{
+    unsigned char bytes[2] = {(unsigned char)(value & 0xFF), (unsigned char)(value >> 8)};
+    checkpoint_put_bytes(buf, bytes, 2);
+}
+
+void checkpoint_put_job(CheckpointBuffer *buf, int job)
+{
+    if (checkpoint_job_bytes() == 1)
+    {
+        unsigned char byte = (unsigned char)job;
+        checkpoint_put_bytes(buf, &byte, 1);
+    }
+    else
+    {
+        checkpoint_put_u16(buf, job);
+    }
+}
+
+typedef struct
+{
+    int start;
+    int end;
+    int job;
+} ReplayOp;
+
+int compare_replay_ops(const void *a, const void *b)
+{
+    const ReplayOp *x = (const ReplayOp *)a;
+    const ReplayOp *y = (const ReplayOp *)b;
+    if (x->start != y->start)
+        return x->start - y->start;
+    if (x->end != y->end)
+        return x->end - y->end;
+    return x->job - y->job;
+}
+
+// Reconstrói a sequência de jobs que gera o estado do bloco, ignorando as últimas
+// trail_size operações do trilho. Cada operação começa no máximo entre o fim da
+// anterior do job e o da anterior da máquina, por isso ordenar pelo início repõe a
+// ordem em cada máquina e em cada job, e repetir a sequência dá o mesmo estado. A
+// última operação aplicada fica no fim, para que o estado repetido tenha o mesmo
+// last_job (o resto é o estado do pai, que a ordenação também repõe).
+int subproblem_sequence(int *block, const UndoRecord *trail, int trail_size, int *sequence)
+{
+    Subproblem sp = subproblem_view(block, instance_dims());
+    int base_next_op[num_jobs];
+    for (int j = 0; j < num_jobs; j++)
+    {
+        base_next_op[j] = sp.job_next_op[j];
+    }
+    for (int k = 0; k < trail_size; k++)
+    {
+        base_next_op[trail[k].job]--;
+    }
+    int last_job = (trail_size > 0) ? trail[0].previous_last_job : *sp.last_job;
+    if (last_job >= 0)
+        base_next_op[last_job]--;
+
+    ReplayOp ops[num_ops];
+    int count = 0;
+    for (int j = 0; j < num_jobs; j++)
+    {
+        for (int op = 0; op < base_next_op[j]; op++)
+        {
+            ops[count].start = sp.schedule[j * num_machines + op];
+            ops[count].end = ops[count].start + job_duration[j * num_machines + op];
+            ops[count].job = j;
+            count++;
+        }
+    }
+    qsort(ops, count, sizeof(ReplayOp), compare_replay_ops);
+    for (int k = 0; k < count; k++)
+    {
+        sequence[k] = ops[k].job;
+    }
+    if (last_job >= 0)
+        sequence[count++] = last_job;
+    return count;
+}
+
+// Codifica um registo: prefixo (sequência base + jobs extra) e filhos por explorar
+void checkpoint_put_record(CheckpointBuffer *buf, const int *sequence, int length,
+                           const int *extra, int extra_length, const int *children, int num_children)
+{
+    checkpoint_put_u16(buf, length + extra_length);
+    for (int k = 0; k < length; k++)
+        checkpoint_put_job(buf, sequence[k]);
+    for (int k = 0; k < extra_length; k++)
+        checkpoint_put_job(buf, extra[k]);
+    checkpoint_put_u16(buf, num_children);
+    for (int k = 0; k < num_children; k++)
+        checkpoint_put_job(buf, children[k]);
+    buf->records++;
+}
+
+// Fronteira da DFS de uma thread: um registo por nó da pilha com filhos por explorar,
+// do mais profundo para a raiz, que é a ordem em que a DFS os visitaria
+void checkpoint_encode_search(CheckpointBuffer *buf, SearchContext *ctx)
+{
+    if (ctx->num_frames == 0)
+        return;
+
+    int sequence[num_ops];
+    int path[num_ops];
+    int children[num_jobs];
+    int length = subproblem_sequence(ctx->state, ctx->trail, ctx->trail_size, sequence);
+    for (int k = 0; k < ctx->trail_size; k++)
+    {
+        path[k] = ctx->trail[k].job;
+    }
+
+    for (int f = ctx->num_frames - 1; f >= 0; f--)
+    {
+        SearchFrame *frame = &ctx->frames[f];
+        int remaining = frame->num_children - frame->next_child;
+        if (remaining <= 0)
+            continue;
+        for (int k = 0; k < remaining; k++)
+        {
+            children[k] = frame->children[frame->next_child + k].job;
+        }
+        checkpoint_put_record(buf, sequence, length, path, f, children, remaining);
+    }
+}
+
+// Monta a imagem completa do checkpoint. Chamada pela última thread a chegar, com
+// todas as outras paradas, por isso os deques e os buffers podem ser lidos sem locks.
+void checkpoint_build_image()
+{
+    CheckpointBuffer *img = &checkpoint_image;
+    CheckpointBuffer frontier = {NULL, 0, 0, 0};
+    int sequence[num_ops];
+
+    for (int t = 0; t < num_workers; t++)
+    {
+        CheckpointBuffer *own = &thread_states[t].checkpoint;
+        if (own->size > 0)
+            checkpoint_put_bytes(&frontier, own->data, own->size);
+        frontier.records += own->records;
+
+        // O dono retira do fim do deque, por isso os registos seguem essa ordem
+        WorkDeque *dq = &work_deques[t];
+        for (int i = dq->tail - 1; i >= dq->head; i--)
+        {
+            int length = subproblem_sequence(deque_item(dq, i), NULL, 0, sequence);
+            checkpoint_put_record(&frontier, sequence, length, NULL, 0, NULL, 0);
+        }
+    }
+    for (int i = 0; i < node_pool.size; i++)
+    {
+        int *block = node_pool.blocks + (size_t)node_pool.heap[i].slot * subproblem_ints;
+        int length = subproblem_sequence(block, NULL, 0, sequence);
+        checkpoint_put_record(&frontier, sequence, length, NULL, 0, NULL, 0);
+    }
+    for (long long i = resume_next; i < resume_count; i++)
+    {
+        const ResumeNode *node = &resume_nodes[i];
+        int extra = node->last_job;
+        checkpoint_put_record(&frontier, &resume_jobs[node->offset], node->length,
+                              &extra, extra >= 0 ? 1 : 0, NULL, 0);
+    }
+
+    // Incumbente: o escalonamento está no buffer indicado por best_incumbent
+    unsigned long long slot = best_incumbent & INCUMBENT_HEURISTIC;
+    int makespan = (int)(best_incumbent >> 32);
+    const int *schedule = best_schedule;
+    if (slot != INCUMBENT_HEURISTIC)
+        schedule = thread_states[slot / 2].schedules + (slot % 2) * num_ops;
+
+    int header[5] = {CHECKPOINT_VERSION, num_jobs, num_machines, checkpoint_job_bytes(), makespan};
+    unsigned long long hash = instance_hash();
+    long long counters[3] = {nodes_explored, steals_performed, subproblems_donated};
+    double times[2] = {checkpoint_prior_wall + (getClock() - global_start_time),
+                       checkpoint_prior_cpu + (double)clock() / CLOCKS_PER_SEC};
+    long long sizes[2] = {frontier.records, (long long)frontier.size};
+
+    img->size = 0;
+    img->records = frontier.records;
+    checkpoint_put_bytes(img, "JSSBNBCK", 8);
+    checkpoint_put_bytes(img, header, sizeof(header));
+    checkpoint_put_bytes(img, &hash, sizeof(hash));
+    checkpoint_put_bytes(img, counters, sizeof(counters));
+    checkpoint_put_bytes(img, times, sizeof(times));
+    checkpoint_put_bytes(img, schedule, sizeof(int) * num_ops);
+    checkpoint_put_bytes(img, sizes, sizeof(sizes));
+    if (frontier.size > 0)
+        checkpoint_put_bytes(img, frontier.data, frontier.size);
+    free(frontier.data);
+}
+
+// Escreve a imagem num ficheiro temporário e troca-o pelo anterior, para que uma
+// interrupção a meio da escrita não destrua o último checkpoint válido
+void checkpoint_write_image()
+{
+    char temp_filename[4096];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", checkpoint_filename);
+    FILE *file = fopen(temp_filename, "wb");
+    if (!file)
+    {
+        printf("Erro ao criar ficheiro de checkpoint: %s\n", temp_filename);
+        return;
+    }
+    size_t written = fwrite(checkpoint_image.data, 1, checkpoint_image.size, file);
+    fclose(file);
+    if (written != checkpoint_image.size || rename(temp_filename, checkpoint_filename) != 0)
+    {
+        printf("Erro ao escrever ficheiro de checkpoint: %s\n", checkpoint_filename);
+        return;
+    }
+    checkpoints_written++;
+    LOG(LOG_INFO, "Checkpoint guardado: %lld subproblemas abertos, %zu bytes\n",
+        checkpoint_image.records, checkpoint_image.size);
+}
+
+// Ponto de encontro de um checkpoint. A thread guarda a sua fronteira (ctx pode ser
+// NULL se não tiver trabalho) e espera que todas cheguem; a última monta a imagem,
+// liberta as outras e escreve o ficheiro fora da pausa.
+void checkpoint_rendezvous(ThreadState *ts, SearchContext *ctx)
+{
+    double pause_start = getClock();
+    int generation;
+#ifdef _OPENMP
+#pragma omp atomic read seq_cst
+#endif
+    generation = checkpoint_generation;
+
+    flush_thread_counters(ts);
+    ts->checkpoint.size = 0;
+    ts->checkpoint.records = 0;
+    if (ctx)
+        checkpoint_encode_search(&ts->checkpoint, ctx);
+
+#ifdef _OPENMP
+#pragma omp atomic update seq_cst
+#endif
+    checkpoint_arrived++;
+
+    int closer = 0;
+    while (1)
+    {
+        int done, arrived, active;
+#ifdef _OPENMP
+#pragma omp atomic read seq_cst
+#endif
+        done = checkpoint_done_generation;
+        if (done >= generation)
+            break;
+
+#ifdef _OPENMP
+#pragma omp atomic read seq_cst
+#endif
+        arrived = checkpoint_arrived;
+#ifdef _OPENMP
+#pragma omp atomic read seq_cst
+#endif
+        active = active_workers;
+        if (arrived >= active)
+        {
+            int closing;
+#ifdef _OPENMP
+#pragma omp atomic capture seq_cst
+#endif
+            {
+                closing = checkpoint_closing;
+                checkpoint_closing = 1;
+            }
+            if (!closing)
+            {
+                checkpoint_build_image();
+                next_checkpoint_time = getClock() + checkpoint_interval;
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+                checkpoint_requested = 0;
+#ifdef _OPENMP
+#pragma omp atomic write seq_cst
+#endif
+                checkpoint_done_generation = generation;
+                closer = 1;
+                break;
+            }
+        }
+#ifdef _OPENMP
+        sched_yield();
+#endif
+    }
+
+    double pause = getClock() - pause_start;
+#ifdef _OPENMP
+#pragma omp critical(checkpoint_pause)
+#endif
+    {
+        if (pause > checkpoint_max_pause)
+            checkpoint_max_pause = pause;
+    }
+
+    if (closer)
+        checkpoint_write_image();
+}
+
+// Verificação barata, feita em cada nó, de um pedido de checkpoint pendente
+static inline int checkpoint_pending()
+{
+    int requested;
+#ifdef _OPENMP
+#pragma omp atomic read relaxed
+#endif
+    requested = checkpoint_requested;
+    return requested;
+}
+
+// Reconstrói o bloco de um subproblema aplicando a sequência de jobs a partir da raiz
+void replay_sequence(int *block, const int *jobs, int length, int last_job)
+{
+    Dims d = instance_dims();
+    Subproblem sp = subproblem_view(block, d);
+    for (int k = 0; k < num_ops; k++)
+        sp.schedule[k] = -1;
+    for (int k = num_ops; k < subproblem_ints; k++)
+        block[k] = 0;
+    *sp.last_job = -1;
+
+    for (int k = 0; k <= length; k++)
+    {
+        int j = (k < length) ? jobs[k] : last_job;
+        if (j < 0)
+            break;
+        JobInfo cand;
+        cand.job = j;
+        cand.op = sp.job_next_op[j];
+        cand.machine = job_machine[j * num_machines + cand.op];
+        cand.duration = job_duration[j * num_machines + cand.op];
+        cand.discrepancy = 0;
+        cand.earliest_start = (sp.job_completion[j] > sp.machine_completion[cand.machine]) ? sp.job_completion[j] : sp.machine_completion[cand.machine];
+        apply_operation(&sp, &cand, d);
+    }
+}
+
+// Retira o próximo subproblema lido do checkpoint; devolve 0 se já não houver
+int resume_pool_claim(int *block)
+{
+    if (resume_count == 0)
+        return 0;
+
+    long long index;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+    index = resume_next++;
+    if (index >= resume_count)
+        return 0;
+
+    const ResumeNode *node = &resume_nodes[index];
+    replay_sequence(block, &resume_jobs[node->offset], node->length, node->last_job);
+    return 1;
+}
+
+int checkpoint_read_u16(FILE *file, int *value)
+{
+    unsigned char bytes[2];
+    if (fread(bytes, 1, 2, file) != 2)
+        return 0;
+    *value = bytes[0] | (bytes[1] << 8);
+    return 1;
+}
+
+int checkpoint_read_job(FILE *file, int job_bytes, int *job)
+{
+    if (job_bytes == 2)
+        return checkpoint_read_u16(file, job);
+    unsigned char byte;
+    if (fread(&byte, 1, 1, file) != 1)
+        return 0;
+    *job = byte;
+    return 1;
+}
+
+// Lê um checkpoint: repõe o incumbente e os contadores e guarda os subproblemas
+// abertos em resume_nodes
+void read_checkpoint(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+    {
+        printf("ERRO: Ficheiro de checkpoint %s nao encontrado\n", filename);
+        exit(1);
+    }
+
+    char magic[8];
+    int header[5];
+    unsigned long long hash;
+    long long counters[3];
+    double times[2];
+    long long sizes[2];
+    int *schedule = (int *)checked_malloc(sizeof(int) * num_ops, "o checkpoint");
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, "JSSBNBCK", 8) != 0 ||
+        fread(header, sizeof(header), 1, file) != 1 || header[0] != CHECKPOINT_VERSION)
+    {
+        printf("ERRO: Ficheiro de checkpoint invalido: %s\n", filename);
+        exit(1);
+    }
+    if (header[1] != num_jobs || header[2] != num_machines || header[3] != checkpoint_job_bytes() ||
+        fread(&hash, sizeof(hash), 1, file) != 1 || hash != instance_hash())
+    {
+        printf("ERRO: O checkpoint %s nao corresponde a instancia de entrada\n", filename);
+        exit(1);
+    }
+    if (fread(counters, sizeof(counters), 1, file) != 1 || fread(times, sizeof(times), 1, file) != 1 ||
+        fread(schedule, sizeof(int) * num_ops, 1, file) != 1 || fread(sizes, sizeof(sizes), 1, file) != 1)
+    {
+        printf("ERRO: Ficheiro de checkpoint truncado: %s\n", filename);
+        exit(1);
+    }
+
+    // Os registos são expandidos num subproblema por filho por explorar
+    int job_bytes = header[3];
+    long long records = sizes[0];
+    long long capacity = 1024;
+    long long jobs_capacity = 4096;
+    long long jobs_used = 0;
+    resume_nodes = (ResumeNode *)checked_malloc(sizeof(ResumeNode) * capacity, "o checkpoint");
+    resume_jobs = (int *)checked_malloc(sizeof(int) * jobs_capacity, "o checkpoint");
+    resume_count = 0;
+    int job_count[num_jobs]; // Operações de cada job no prefixo do registo
+    for (long long r = 0; r < records; r++)
+    {
+        int length, num_children;
+        if (!checkpoint_read_u16(file, &length) || length > num_ops)
+        {
+            printf("ERRO: Ficheiro de checkpoint truncado: %s\n", filename);
+            exit(1);
+        }
+        if (jobs_used + length > jobs_capacity)
+        {
+            while (jobs_used + length > jobs_capacity)
+                jobs_capacity *= 2;
+            resume_jobs = (int *)realloc(resume_jobs, sizeof(int) * jobs_capacity);
+            if (!resume_jobs)
+            {
+                printf("ERRO: Memoria insuficiente para o checkpoint\n");
+                exit(1);
+            }
+        }
+        // Cada job aparece no máximo num_machines vezes no prefixo e no filho, senão a
+        // reconstrução leria operações de outro job
+        memset(job_count, 0, sizeof(job_count));
+        long long offset = jobs_used;
+        for (int k = 0; k < length; k++)
+        {
+            int job;
+            if (!checkpoint_read_job(file, job_bytes, &job) || job >= num_jobs || ++job_count[job] > num_machines)
+            {
+                printf("ERRO: Ficheiro de checkpoint truncado: %s\n", filename);
+                exit(1);
+            }
+            resume_jobs[jobs_used++] = job;
+        }
+        if (!checkpoint_read_u16(file, &num_children) || num_children > num_jobs)
+        {
+            printf("ERRO: Ficheiro de checkpoint truncado: %s\n", filename);
+            exit(1);
+        }
+        for (int k = 0; k < (num_children > 0 ? num_children : 1); k++)
+        {
+            int job = -1;
+            if (num_children > 0 && (!checkpoint_read_job(file, job_bytes, &job) || job >= num_jobs ||
+                                     job_count[job] >= num_machines))
+            {
+                printf("ERRO: Ficheiro de checkpoint truncado: %s\n", filename);
+                exit(1);
+            }
+            if (resume_count == capacity)
+            {
+                capacity *= 2;
+                resume_nodes = (ResumeNode *)realloc(resume_nodes, sizeof(ResumeNode) * capacity);
+                if (!resume_nodes)
+                {
+                    printf("ERRO: Memoria insuficiente para o checkpoint\n");
+                    exit(1);
+                }
+            }
+            resume_nodes[resume_count].offset = offset;
+            resume_nodes[resume_count].length = length;
+            resume_nodes[resume_count].last_job = job;
+            resume_count++;
+        }
+    }
+    fclose(file);
+
+    if (header[4] < best_makespan)
+    {
+        best_makespan = header[4];
+        memcpy(best_schedule, schedule, sizeof(int) * num_ops);
+    }
+    free(schedule);
+    nodes_explored = counters[0];
+    steals_performed = counters[1];
+    subproblems_donated = counters[2];
+    checkpoint_prior_wall = times[0];
+    checkpoint_prior_cpu = times[1];
+    resume_next = 0;
+
+    printf("Retomado do checkpoint %s: %lld subproblemas abertos, %lld nos ja explorados, makespan %d\n",
+           filename, resume_count, nodes_explored, best_makespan);
+}
+
+// Com MPI, um rank sem trabalho só sai da busca quando a deteção de terminação
+// confirma que nenhum processo tem trabalho; sem MPI sai logo
+static inline int mpi_search_done()
+{
+#ifdef USE_MPI
+    int done;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    done = mpi_done;
+    return done || mpi_size == 1;
+#else
+    return 1;
+#endif
+}
+
+#ifdef USE_MPI
+// Divide a raiz pelos ranks: todos expandem a árvore em largura da mesma forma até
+// haver pelo menos MPI_SPLIT_FACTOR subproblemas por rank, e cada um fica com os de
+// índice congruente com o seu. Os filhos são gerados por generate_children, pela
+// ordem da DFS, e entram no repositório usado para retomar um checkpoint; devolve
+// quantos couberam a este rank.
+long long mpi_split_root()
+{
+    Dims d = instance_dims();
+    SearchContext *ctx = search_context_create();
+    ctx->thread = &thread_states[0];
+    SearchFrame *frame = &ctx->frames[0];
+    int *level = (int *)checked_malloc(sizeof(int), "a divisao da raiz");
+    long long count = 1;
+    int depth = 0;
+    while (count < (long long)MPI_SPLIT_FACTOR * mpi_size && depth < num_ops)
+    {
+        int *next = (int *)checked_malloc(sizeof(int) * count * num_jobs * (depth + 1), "a divisao da raiz");
+        long long next_count = 0;
+        for (long long i = 0; i < count; i++)
+        {
+            replay_sequence(ctx->state, &level[i * depth], depth, -1);
+            Subproblem state = subproblem_view(ctx->state, d);
+            bound_engine_init(&ctx->engine, state.job_completion, state.job_next_op);
+            generate_children(ctx, frame, 0, d);
+            for (int c = 0; c < frame->num_children; c++)
+            {
+                int *sequence = &next[next_count * (depth + 1)];
+                memcpy(sequence, &level[i * depth], sizeof(int) * depth);
+                sequence[depth] = frame->children[c].job;
+                next_count++;
+            }
+        }
+        free(level);
+        level = next;
+        count = next_count;
+        depth++;
+    }
+    search_context_destroy(ctx);
+
+    resume_nodes = (ResumeNode *)checked_malloc(sizeof(ResumeNode) * (count / mpi_size + 1), "a divisao da raiz");
+    resume_jobs = level;
+    resume_count = 0;
+    resume_next = 0;
+    for (long long i = mpi_rank; i < count; i += mpi_size)
+    {
+        resume_nodes[resume_count].offset = i * depth;
+        resume_nodes[resume_count].length = depth;
+        resume_nodes[resume_count].last_job = -1;
+        resume_count++;
+    }
+    return resume_count;
+}
+
+// Difunde o incumbente local se for melhor do que o último conhecido. As mensagens
+// são de um inteiro e saem logo, por isso MPI_Send não bloqueia à espera do destino.
+void mpi_broadcast_incumbent()
+{
+    unsigned long long incumbent;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    incumbent = best_incumbent;
+    int makespan = (int)(incumbent >> 32);
+    if (makespan >= mpi_known_makespan)
+        return;
+
+    mpi_known_makespan = makespan;
+    for (int r = 0; r < mpi_size; r++)
+    {
+        if (r != mpi_rank)
+            MPI_Send(&makespan, 1, MPI_INT, r, MPI_TAG_INCUMBENT, MPI_COMM_WORLD);
+    }
+    mpi_broadcasts++;
+}
+
+// Retira para mpi_buffer subproblemas para outro rank: metade dos mais antigos do
+// primeiro deque com trabalho ou, no best-first, metade do pool; devolve quantos
+int mpi_take_work()
+{
+    if (search_stopped() || mpi_done)
+        return 0;
+
+    int taken = 0;
+    for (int t = 0; t < num_workers && taken == 0; t++)
+    {
+        WorkDeque *dq = &work_deques[t];
+        if (deque_size(dq) <= 0)
+            continue;
+        deque_lock(dq);
+        int available = dq->tail - dq->head;
+        taken = (available + 1) / 2;
+        if (taken > MPI_STEAL_MAX)
+            taken = MPI_STEAL_MAX;
+        if (taken > 0)
+        {
+            memcpy(mpi_buffer, deque_item(dq, dq->head), sizeof(int) * subproblem_ints * taken);
+            dq->head += taken;
+            if (dq->head == dq->tail)
+            {
+                dq->head = 0;
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+                dq->tail = 0;
+            }
+        }
+        deque_unlock(dq);
+    }
+    if (taken == 0 && node_pool.blocks)
+    {
+        // Os nós do pool voltam a ser avaliados no destino
+        int limit = (node_pool_size() + 1) / 2;
+        int bound;
+        if (limit > MPI_STEAL_MAX)
+            limit = MPI_STEAL_MAX;
+        while (taken < limit && node_pool_pop(mpi_buffer + (size_t)taken * subproblem_ints, &bound))
+            taken++;
+    }
+
+    if (taken > 0)
+    {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        outstanding_work -= taken;
+    }
+    return taken;
+}
+
+// Recebe e trata uma mensagem já anunciada por MPI_Iprobe/MPI_Probe
+void mpi_handle_message(const MPI_Status *probe)
+{
+    int source = probe->MPI_SOURCE;
+    MPI_Status status;
+    switch (probe->MPI_TAG)
+    {
+    case MPI_TAG_INCUMBENT:
+    {
+        int makespan;
+        MPI_Recv(&makespan, 1, MPI_INT, source, MPI_TAG_INCUMBENT, MPI_COMM_WORLD, &status);
+        mpi_incumbents_received++;
+        if (makespan < mpi_known_makespan)
+        {
+            mpi_known_makespan = makespan;
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+            remote_makespan = makespan;
+        }
+        break;
+    }
+    case MPI_TAG_STEAL_REQUEST:
+    {
+        MPI_Recv(NULL, 0, MPI_INT, source, MPI_TAG_STEAL_REQUEST, MPI_COMM_WORLD, &status);
+        int count = mpi_take_work();
+        MPI_Send(mpi_buffer, count * subproblem_ints, MPI_INT, source, MPI_TAG_STEAL_REPLY, MPI_COMM_WORLD);
+
+        // Sem subproblemas nos deques, as threads com trabalho passam a doar nós
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+        mpi_work_requested = (count == 0 && !search_stopped() && !mpi_done);
+        if (count > 0)
+        {
+            mpi_work_balance++;
+            mpi_subproblems_sent += count;
+        }
+        break;
+    }
+    case MPI_TAG_STEAL_REPLY:
+    {
+        int ints;
+        MPI_Recv(mpi_buffer, MPI_STEAL_MAX * subproblem_ints, MPI_INT, source, MPI_TAG_STEAL_REPLY, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_INT, &ints);
+        int count = ints / subproblem_ints;
+        for (int k = 0; k < count; k++)
+        {
+            deque_push(&work_deques[0], mpi_buffer + (size_t)k * subproblem_ints);
+        }
+        mpi_steal_pending = 0;
+        if (count > 0)
+        {
+            mpi_work_balance--;
+            mpi_black = 1;
+            mpi_subproblems_received += count;
+            mpi_failed_steals = 0;
+        }
+        else
+        {
+            // Tenta o rank seguinte; depois de uma volta completa sem sucesso espera um pouco
+            mpi_next_victim = (mpi_next_victim + 1) % mpi_size;
+            if (mpi_next_victim == mpi_rank)
+                mpi_next_victim = (mpi_next_victim + 1) % mpi_size;
+            if (++mpi_failed_steals % (mpi_size - 1) == 0)
+                mpi_next_steal_time = getClock() + MPI_STEAL_BACKOFF;
+        }
+        break;
+    }
+    case MPI_TAG_TOKEN:
+        MPI_Recv(mpi_token, 2, MPI_LONG_LONG, source, MPI_TAG_TOKEN, MPI_COMM_WORLD, &status);
+        mpi_has_token = 1;
+        break;
+    case MPI_TAG_DONE:
+        MPI_Recv(NULL, 0, MPI_INT, source, MPI_TAG_DONE, MPI_COMM_WORLD, &status);
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+        mpi_done = 1;
+        break;
+    }
+}
+
+void mpi_receive_pending()
+{
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    while (flag)
+    {
+        mpi_handle_message(&status);
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    }
+}
+
+// Chamada só pela thread 0: difunde o incumbente, trata as mensagens recebidas e,
+// com o rank passivo (sem trabalho ou parado), passa o testemunho de terminação e
+// pede trabalho a outro rank
+void mpi_poll()
+{
+    if (mpi_size == 1)
+        return;
+    mpi_broadcast_incumbent();
+    mpi_receive_pending();
+    if (mpi_done)
+        return;
+
+    long long pending;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    pending = outstanding_work;
+    if (pending > 0 && !search_stopped())
+        return;
+
+    // Dijkstra-Safra: o testemunho soma os saldos de mensagens com trabalho e fica
+    // preto se algum rank recebeu trabalho desde a última volta. Ao regressar ao
+    // rank 0 branco, com saldo nulo e o rank 0 branco, não há trabalho em lado nenhum.
+    if (mpi_rank == 0 && !mpi_token_out)
+    {
+        long long token[2] = {0, 0};
+        mpi_black = 0;
+        mpi_token_out = 1;
+        MPI_Send(token, 2, MPI_LONG_LONG, 1, MPI_TAG_TOKEN, MPI_COMM_WORLD);
+    }
+    else if (mpi_has_token)
+    {
+        mpi_has_token = 0;
+        if (mpi_rank == 0)
+        {
+            mpi_token_out = 0;
+            if (!mpi_token[1] && !mpi_black && mpi_token[0] + mpi_work_balance == 0)
+            {
+                for (int r = 1; r < mpi_size; r++)
+                    MPI_Send(NULL, 0, MPI_INT, r, MPI_TAG_DONE, MPI_COMM_WORLD);
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+                mpi_done = 1;
+                return;
+            }
+        }
+        else
+        {
+            long long token[2] = {mpi_token[0] + mpi_work_balance, mpi_token[1] || mpi_black};
+            mpi_black = 0;
+            MPI_Send(token, 2, MPI_LONG_LONG, (mpi_rank + 1) % mpi_size, MPI_TAG_TOKEN, MPI_COMM_WORLD);
+        }
+    }
+
+    if (!search_stopped() && !mpi_steal_pending && getClock() >= mpi_next_steal_time)
+    {
+        MPI_Send(NULL, 0, MPI_INT, mpi_next_victim, MPI_TAG_STEAL_REQUEST, MPI_COMM_WORLD);
+        mpi_steal_pending = 1;
+    }
+}
+
+// Depois da terminação: responde aos pedidos ainda em trânsito até todos os ranks
+// terem resposta aos seus (barreira não bloqueante) e recebe os incumbentes que faltam
+void mpi_finish_messages()
+{
+    if (mpi_size == 1)
+        return;
+    mpi_broadcast_incumbent();
+
+    MPI_Request barrier;
+    int started = 0;
+    int complete = 0;
+    while (!complete)
+    {
+        mpi_receive_pending();
+        if (!started && !mpi_steal_pending)
+        {
+            MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+            started = 1;
+        }
+        if (started)
+            MPI_Test(&barrier, &complete, MPI_STATUS_IGNORE);
+    }
+
+    // Cada difusão de outro rank traz uma mensagem a este
+    long long total_broadcasts;
+    MPI_Allreduce(&mpi_broadcasts, &total_broadcasts, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    while (mpi_incumbents_received < total_broadcasts - mpi_broadcasts)
+    {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, MPI_TAG_INCUMBENT, MPI_COMM_WORLD, &status);
+        mpi_handle_message(&status);
+    }
+}
+
+// Junta no rank 0 o melhor escalonamento, os contadores e o lower bound de todos os ranks
+void mpi_collect_results()
+{
+    struct
+    {
+        int makespan;
+        int rank;
+    } local = {best_makespan, mpi_rank}, best;
+    MPI_Allreduce(&local, &best, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
+    if (best.rank != 0)
+    {
+        if (mpi_rank == best.rank)
+            MPI_Send(best_schedule, num_ops, MPI_INT, 0, 0, MPI_COMM_WORLD);
+        else if (mpi_rank == 0)
+            MPI_Recv(best_schedule, num_ops, MPI_INT, best.rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    best_makespan = best.makespan;
+
+    int bound = global_lower_bound;
+    MPI_Allreduce(&bound, &global_lower_bound, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    int stop = search_stop;
+    MPI_Allreduce(&stop, &search_stop, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    if (mpi_rank == 0)
+    {
+        mpi_rank_nodes = (long long *)checked_malloc(sizeof(long long) * mpi_size, "as metricas dos ranks");
+        mpi_rank_idle = (double *)checked_malloc(sizeof(double) * mpi_size, "as metricas dos ranks");
+    }
+    MPI_Gather(&nodes_explored, 1, MPI_LONG_LONG, mpi_rank_nodes, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Gather(&mpi_idle_time, 1, MPI_DOUBLE, mpi_rank_idle, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    long long counters[4] = {nodes_explored, steals_performed, subproblems_donated, mpi_subproblems_sent};
+    long long totals[4];
+    MPI_Reduce(counters, totals, 4, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long broadcasts = mpi_broadcasts;
+    MPI_Reduce(&broadcasts, &mpi_broadcasts, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long prunes[NUM_DOMINANCE_RULES];
+    MPI_Reduce(dominance_prunes, prunes, NUM_DOMINANCE_RULES, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (mpi_rank == 0)
+    {
+        nodes_explored = totals[0];
+        steals_performed = totals[1];
+        subproblems_donated = totals[2];
+        mpi_subproblems_sent = totals[3];
+        for (int r = 0; r < NUM_DOMINANCE_RULES; r++)
+            dominance_prunes[r] = prunes[r];
+    }
+#ifdef SEARCH_PROFILE
+    long long *profile = (long long *)checked_malloc(sizeof(long long) * profile_size(), "o perfil da busca");
+    MPI_Reduce(search_profile, profile, profile_size(), MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (mpi_rank == 0)
+        memcpy(search_profile, profile, sizeof(long long) * profile_size());
+    free(profile);
+#endif
+    node_limit = mpi_total_node_limit;
+}
+#endif
+
+// Ao cancelar, regista o menor bound dos nós abertos da pilha: os nós com filhos por
+// explorar e o do topo, cujo último filho pode ter ficado por expandir
+void record_open_frontier(SearchContext *ctx)
+{
+    ThreadState *ts = ctx->thread;
+    for (int f = 0; f < ctx->num_frames; f++)
+    {
+        const SearchFrame *frame = &ctx->frames[f];
+        int open = frame->next_child < frame->num_children || f == ctx->num_frames - 1;
+        if (open && frame->lower_bound < ts->open_bound)
+            ts->open_bound = frame->lower_bound;
+    }
+}
+
+// Guarda no pool o nó do estado atual, já avaliado com lower_bound, e volta ao pai.
+// Com o pool cheio, o nó passa a ser o topo da pilha e a busca segue em DFS a partir
+// dele; devolve 0 nesse caso.
+BNB_KERNEL int store_or_descend(SearchContext *ctx, int lower_bound, const Dims d)
+{
+    PROFILE(unsigned long long copy_start = profile_cycles();)
+    int stored = node_pool_push(ctx->state, lower_bound, *subproblem_view(ctx->state, d).depth);
+    PROFILE(profile_add_cycles(ctx->thread->profile, PROFILE_STATE_COPY, copy_start);)
+    if (stored)
+    {
+        unmake_move(ctx, d);
+        return 1;
+    }
+
+    ctx->thread->pool_fallbacks++;
+    if (generate_children(ctx, &ctx->frames[ctx->num_frames], lower_bound, d))
+        ctx->num_frames++;
+    else
+        unmake_move(ctx, d);
+    return 0;
+}
+
+// Mudança para best-first no modo híbrido: avalia os filhos por explorar da pilha, do
+// topo para a raiz, e guarda os abertos no pool. Devolve 0 se parar a meio (pool
+// cheio ou busca cancelada), deixando a pilha coerente para a DFS continuar.
+BNB_KERNEL int move_frontier_to_pool(SearchContext *ctx, const Dims d)
+{
+    while (ctx->num_frames > 0)
+    {
+        if (search_stopped())
+            return 0;
+
+        SearchFrame *frame = &ctx->frames[ctx->num_frames - 1];
+        if (frame->next_child >= frame->num_children)
+        {
+            ctx->num_frames--;
+            if (ctx->num_frames > 0)
+                unmake_move(ctx, d);
+            continue;
+        }
+
+        JobInfo cand = frame->children[frame->next_child++];
+        make_move(ctx, &cand, d);
+        int lower_bound = evaluate_node(ctx, cand.job_bound, d);
+        if (lower_bound < 0)
+            unmake_move(ctx, d);
+        else if (!store_or_descend(ctx, lower_bound, d))
+            return 0;
+    }
+    return 1;
+}
+
+// Ciclo da DFS com pilha explícita sobre os nós já em ctx->frames: cada filho é
+// aplicado no lugar (make) e desfeito pelo trilho no retrocesso (unmake)
+BNB_KERNEL void dfs_loop(SearchContext *ctx, const Dims d)
+{
+    while (ctx->num_frames > 0)
+    {
+        SearchFrame *frame = &ctx->frames[ctx->num_frames - 1];
+
+        // Modo híbrido: ao surgir o primeiro incumbente, a pilha passa para o pool
+        if (ctx->phase == PHASE_DFS && load_search_phase() == PHASE_BEST)
+        {
+            ctx->phase = PHASE_BEST;
+            if (move_frontier_to_pool(ctx, d))
+                break;
+            continue;
+        }
+
+        // Busca cancelada: os nós abertos ficam limitados pelo bound dos seus pais
+        if (search_stopped())
+        {
+            record_open_frontier(ctx);
+            ctx->num_frames = 0;
+            break;
+        }
+
+        // Nó esgotado: volta ao nó pai
+        if (frame->next_child >= frame->num_children)
+        {
+            ctx->num_frames--;
+            if (ctx->num_frames > 0)
+                unmake_move(ctx, d);
+            continue;
+        }
+
+        if (checkpoint_pending())
+            checkpoint_rendezvous(ctx->thread, ctx);
+
+        if (should_split())
+        {
+            PROFILE(unsigned long long copy_start = profile_cycles();)
+            donate_open_nodes(ctx, d);
+            PROFILE(profile_add_cycles(ctx->thread->profile, PROFILE_STATE_COPY, copy_start);)
+        }
+
+        JobInfo cand = frame->children[frame->next_child++];
+        make_move(ctx, &cand, d);
+        if (expand_node(ctx, &ctx->frames[ctx->num_frames], cand.job_bound, d))
+        {
+            ctx->num_frames++;
+        }
+        else
+        {
+            unmake_move(ctx, d);
+
+            // Tarefa suspensa: o filho volta a estar por explorar e a pilha fica intacta
+            if (ctx->thread->task_suspended)
+            {
+                frame->next_child--;
+                break;
+            }
+        }
+    }
+}
+
+// DFS a partir do subproblema em ctx->state
+BNB_KERNEL void branch_and_bound_kernel(SearchContext *ctx, const Dims d)
+{
+    ctx->trail_size = 0;
+    ctx->num_frames = 0;
+    if (expand_node(ctx, &ctx->frames[0], -1, d))
+        ctx->num_frames = 1;
+    dfs_loop(ctx, d);
+}
+
+// Passo best-first sobre o subproblema em ctx->state: avalia-o (se lower_bound < 0,
+// por ainda não ter sido avaliado), gera os filhos e guarda no pool os que ficam
+// abertos. Se o pool encher, os filhos restantes são explorados em DFS.
+BNB_KERNEL void best_first_kernel(SearchContext *ctx, int lower_bound, const Dims d)
+{
+    ctx->trail_size = 0;
+    ctx->num_frames = 0;
+    if (lower_bound < 0)
+    {
+        lower_bound = evaluate_node(ctx, -1, d);
+        if (lower_bound < 0)
+            return;
+    }
+    else if (lower_bound >= ctx->thread->incumbent)
+    {
+        PROFILE(profile_count(ctx->thread->profile, *subproblem_view(ctx->state, d).depth, PROFILE_PRUNE_BOUND, 1);)
+        return; // Podado por um incumbente encontrado depois de o nó entrar no pool
+    }
+
+    SearchFrame *frame = &ctx->frames[0];
+    if (!generate_children(ctx, frame, lower_bound, d))
+        return;
+    ctx->num_frames = 1;
+
+    while (frame->next_child < frame->num_children)
+    {
+        if (search_stopped())
+        {
+            record_open_frontier(ctx);
+            return;
+        }
+
+        JobInfo cand = frame->children[frame->next_child++];
+        make_move(ctx, &cand, d);
+        int child_bound = evaluate_node(ctx, cand.job_bound, d);
+        if (child_bound < 0)
+        {
+            unmake_move(ctx, d);
+        }
+        else if (!store_or_descend(ctx, child_bound, d))
+        {
+            dfs_loop(ctx, d);
+            return;
+        }
+    }
+}
+
+// Instâncias da busca: uma por cada dimensão comum (N jobs x N máquinas, com N
+// operações por máquina), onde as dimensões são constantes de compilação, e uma
+// genérica que lê as dimensões da instância em tempo de execução
+#define DEFINE_SEARCH_KERNEL(NAME, DIMS)                                \
+    void branch_and_bound_##NAME(SearchContext *ctx)                    \
+    {                                                                   \
+        branch_and_bound_kernel(ctx, DIMS);                             \
+    }                                                                   \
+    void best_first_##NAME(SearchContext *ctx, int lower_bound)         \
+    {                                                                   \
+        best_first_kernel(ctx, lower_bound, DIMS);                      \
+    }
+
+DEFINE_SEARCH_KERNEL(6x6, ((Dims){6, 6, 6}))
+DEFINE_SEARCH_KERNEL(8x8, ((Dims){8, 8, 8}))
+DEFINE_SEARCH_KERNEL(10x10, ((Dims){10, 10, 10}))
+DEFINE_SEARCH_KERNEL(15x15, ((Dims){15, 15, 15}))
+DEFINE_SEARCH_KERNEL(generic, instance_dims())
+
+typedef struct
+{
+    int size;
+    const char *name;
+    void (*search)(SearchContext *ctx);
+    void (*best_first)(SearchContext *ctx, int lower_bound);
+} SearchKernel;
+
+const SearchKernel search_kernels[] = {
+    {6, "6x6", branch_and_bound_6x6, best_first_6x6},
+    {8, "8x8", branch_and_bound_8x8, best_first_8x8},
+    {10, "10x10", branch_and_bound_10x10, best_first_10x10},
+    {15, "15x15", branch_and_bound_15x15, best_first_15x15},
+};
+
+void (*branch_and_bound)(SearchContext *ctx) = branch_and_bound_generic;
+void (*best_first_step)(SearchContext *ctx, int lower_bound) = best_first_generic;
+const char *search_kernel_name = "generico";
+
+// Escolhe o núcleo especializado que corresponde ao cabeçalho da instância
+void select_search_kernel()
+{
+    branch_and_bound = branch_and_bound_generic;
+    best_first_step = best_first_generic;
+    search_kernel_name = "generico";
+    for (size_t k = 0; k < sizeof(search_kernels) / sizeof(search_kernels[0]); k++)
+    {
+        int n = search_kernels[k].size;
+        if (num_jobs == n && num_machines == n && machine_stride == n)
+        {
+            branch_and_bound = search_kernels[k].search;
+            best_first_step = search_kernels[k].best_first;
+            search_kernel_name = search_kernels[k].name;
+        }
+    }
+}
+
+// Ciclo principal de cada thread: processa os subproblemas do seu deque e,
+// quando fica sem trabalho, rouba metade do deque de outra thread
+void search_worker()
+{
+#ifdef _OPENMP
+    int tid = omp_get_thread_num();
+#else
+    int tid = 0;
+#endif
+    WorkDeque *own = &work_deques[tid];
+    SearchContext *ctx = search_context_create();
+    ctx->thread = &thread_states[tid];
+    ctx->phase = load_search_phase();
+
+    while (!search_stopped())
+    {
+        if (checkpoint_pending())
+            checkpoint_rendezvous(ctx->thread, NULL);
+
+        // Os subproblemas do deque e do checkpoint ainda não foram avaliados; os do
+        // pool já têm o lower bound calculado
+        int pool_bound = -1;
+        PROFILE(unsigned long long copy_start = profile_cycles();)
+        if (deque_pop(own, ctx->state) || resume_pool_claim(ctx->state) ||
+            node_pool_pop(ctx->state, &pool_bound))
+        {
+            ctx->thread->incumbent = load_best_makespan();
+            Subproblem state = subproblem_view(ctx->state, instance_dims());
+            bound_engine_init(&ctx->engine, state.job_completion, state.job_next_op);
+            ctx->key = tt_state_key(state.job_next_op);
+            PROFILE(profile_add_cycles(ctx->thread->profile, PROFILE_STATE_COPY, copy_start);)
+            if (ctx->phase == PHASE_DFS)
+                ctx->phase = load_search_phase();
+            if (ctx->phase == PHASE_BEST)
+                best_first_step(ctx, pool_bound);
+            else
+                branch_and_bound(ctx);
+
+            // O subproblema só deixa de estar pendente depois de todas as suas doações
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+            outstanding_work--;
+            continue;
+        }
+
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        idle_threads++;
+
+        int got_work = 0;
+#ifdef USE_MPI
+        double idle_since = getClock();
+#endif
+        while (!got_work)
+        {
+#ifdef USE_MPI
+            if (tid == 0)
+                mpi_poll();
+#endif
+            long long pending;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+            pending = outstanding_work;
+#ifdef USE_MPI
+            if (tid == 0)
+            {
+                double now = getClock();
+                if (pending == 0)
+                    mpi_idle_time += now - idle_since;
+                idle_since = now;
+            }
+#endif
+            if (checkpoint_pending())
+                checkpoint_rendezvous(ctx->thread, NULL);
+            if (search_stopped() || (pending == 0 && mpi_search_done()))
+                break;
+
+#ifdef USE_MPI
+            // O trabalho recebido de outro rank entra no deque da thread 0
+            if (deque_size(own) > 0)
+            {
+                got_work = 1;
+                break;
+            }
+#endif
+
+            // Há nós no pool do best-first: volta ao início para os retirar
+            if (node_pool_size() > 0)
+            {
+                got_work = 1;
+                break;
+            }
+
+            // Percorre as outras threads a partir da seguinte, para espalhar os roubos
+            for (int k = 1; k < num_workers && !got_work; k++)
+            {
+                int victim = (tid + k) % num_workers;
+                if (deque_steal_half(&work_deques[victim], own) > 0)
+                {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+                    steals_performed++;
+                    got_work = 1;
+                }
+            }
+
+#ifdef _OPENMP
+            // Cede o processador enquanto espera, para não atrasar as threads com trabalho
+            if (!got_work)
+                sched_yield();
+#endif
+        }
+
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        idle_threads--;
+
+        if (!got_work)
+            break; // Não há trabalho pendente em nenhuma thread: busca terminada
+    }
+
+#ifdef USE_MPI
+    // Um rank parado continua a responder aos outros até à terminação global
+    while (tid == 0 && !mpi_search_done())
+    {
+        mpi_poll();
+#ifdef _OPENMP
+        sched_yield();
+#endif
+    }
+#endif
+
+    // Soma os nós que ainda não entraram no total partilhado
+    flush_thread_counters(ctx->thread);
+#ifdef _OPENMP
+#pragma omp atomic update seq_cst
+#endif
+    active_workers--;
+
+    // Junta os contadores locais da tabela de transposição aos globais
+#ifdef _OPENMP
+#pragma omp critical(tt_counters)
+#endif
+    {
+        tt_probes += ctx->tt_probes;
+        tt_hits += ctx->tt_hits;
+        tt_stores += ctx->tt_stores;
+        tt_replacements += ctx->tt_replacements;
+        pool_fallbacks += ctx->thread->pool_fallbacks;
+    }
+
+    search_context_destroy(ctx);
+}
+
+// Lower bound global no fim da busca: o menor entre o incumbente, os nós abertos
+// nas pilhas das threads, os que ficaram nos deques, no pool ou no checkpoint por
+// retomar e os nós cujos filhos foram cortados. Se for igual ao incumbente, este é ótimo.
+int compute_global_lower_bound()
+{
+    int bound = best_makespan;
+    for (int t = 0; t < num_workers; t++)
+    {
+        if (thread_states[t].open_bound < bound)
+            bound = thread_states[t].open_bound;
+        if (thread_states[t].truncated_bound < bound)
+            bound = thread_states[t].truncated_bound;
+    }
+
+    BoundEngine engine;
+    bound_engine_alloc(&engine);
+    int *block = (int *)checked_malloc(sizeof(int) * subproblem_ints, "o lower bound global");
+    Dims d = instance_dims();
+    for (int t = 0; t < num_workers; t++)
+    {
+        WorkDeque *dq = &work_deques[t];
+        for (int i = dq->head; i < dq->tail; i++)
+        {
+            Subproblem sp = subproblem_view(deque_item(dq, i), d);
+            bound_engine_init(&engine, sp.job_completion, sp.job_next_op);
+            int lb = calculate_improved_lower_bound(&engine, -1, sp.job_completion, sp.machine_completion, sp.job_next_op, d);
+            if (lb < bound)
+                bound = lb;
+        }
+    }
+    for (long long i = resume_next; i < resume_count; i++)
+    {
+        const ResumeNode *node = &resume_nodes[i];
+        replay_sequence(block, &resume_jobs[node->offset], node->length, node->last_job);
+        Subproblem sp = subproblem_view(block, d);
+        bound_engine_init(&engine, sp.job_completion, sp.job_next_op);
+        int lb = calculate_improved_lower_bound(&engine, -1, sp.job_completion, sp.machine_completion, sp.job_next_op, d);
+        if (lb < bound)
+            bound = lb;
+    }
+    if (node_pool.size > 0 && node_pool.heap[0].bound < bound)
+        bound = node_pool.heap[0].bound;
+    free(block);
+    bound_engine_free(&engine);
+    return bound;
+}
+
+// Lista de subproblemas (blocos de subproblem_ints inteiros) que cresce por duplicação
+typedef struct
+{
+    int *blocks;
+    long long count;
+    long long capacity;
+} TaskList;
+
+int *task_list_append(TaskList *list)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+        list->blocks = (int *)realloc(list->blocks, sizeof(int) * subproblem_ints * list->capacity);
+        if (!list->blocks)
+        {
+            printf("ERRO: Memoria insuficiente para as tarefas do modo deterministico\n");
+            exit(1);
+        }
+    }
+    return list->blocks + (size_t)(list->count++) * subproblem_ints;
+}
+
+// Guarda em list os nós por explorar de uma tarefa suspensa pela ordem em que a DFS
+// os visitaria: primeiro os filhos restantes do nó do topo, depois os dos seus pais
+void collect_task_frontier(SearchContext *ctx, TaskList *list)
+{
+    Dims d = instance_dims();
+    memcpy(ctx->scratch, ctx->state, sizeof(int) * subproblem_ints);
+    Subproblem base = subproblem_view(ctx->scratch, d);
+    for (int f = ctx->num_frames - 1; f >= 0; f--)
+    {
+        // ctx->scratch passa a ser o estado do nó f
+        for (int k = ctx->trail_size - 1; k >= f; k--)
+        {
+            undo_operation(&base, &ctx->trail[k], d);
+        }
+        ctx->trail_size = f;
+
+        SearchFrame *frame = &ctx->frames[f];
+        for (int k = frame->next_child; k < frame->num_children; k++)
+        {
+            int *block = task_list_append(list);
+            memcpy(block, ctx->scratch, sizeof(int) * subproblem_ints);
+            Subproblem child = subproblem_view(block, d);
+            apply_operation(&child, &frame->children[k], d);
+        }
+    }
+    ctx->num_frames = 0;
+}
+
+// Resultado de uma tarefa de uma ronda, juntado pela ordem das tarefas
+typedef struct
+{
+    long long nodes;
+    int makespan;  // Melhor makespan encontrado (o incumbente da ronda se nenhum)
+    int *schedule; // Escalonamento correspondente (NULL se não melhorou)
+    TaskList open; // Nós por explorar deixados pela tarefa
+} TaskResult;
+
+// Busca determinística por rondas (ver DET_TASK_NODES)
+void run_deterministic_search(const int *root)
+{
+    SearchContext **contexts = (SearchContext **)checked_malloc(sizeof(SearchContext *) * num_workers, "o modo deterministico");
+    for (int t = 0; t < num_workers; t++)
+    {
+        contexts[t] = search_context_create();
+        contexts[t]->thread = &thread_states[t];
+        thread_states[t].shared_nodes = 0;
+    }
+
+    TaskList tasks = {NULL, 0, 0};
+    memcpy(task_list_append(&tasks), root, sizeof(int) * subproblem_ints);
+    while (tasks.count > 0 && !search_stopped())
+    {
+        // O orçamento da ronda nunca ultrapassa os nós que faltam para o limite
+        long long remaining = node_limit - nodes_explored;
+        if (remaining < tasks.count)
+        {
+            request_stop(STOP_NODES);
+            break;
+        }
+        long long budget = remaining / tasks.count;
+        if (budget > DET_TASK_NODES)
+            budget = DET_TASK_NODES;
+
+        int round_incumbent = best_makespan;
+        TaskResult *results = (TaskResult *)checked_malloc(sizeof(TaskResult) * tasks.count, "o modo deterministico");
+        double round_start = getClock();
+        double busy_time = 0;
+        det_tasks += tasks.count;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_workers) reduction(+ : busy_time)
+#endif
+        for (long long i = 0; i < tasks.count; i++)
+        {
+#ifdef _OPENMP
+            SearchContext *ctx = contexts[omp_get_thread_num()];
+#else
+            SearchContext *ctx = contexts[0];
+#endif
+            ThreadState *ts = ctx->thread;
+            TaskResult *result = &results[i];
+            result->open.blocks = NULL;
+            result->open.count = 0;
+            result->open.capacity = 0;
+            result->schedule = NULL;
+            result->makespan = round_incumbent;
+            result->nodes = 0;
+
+            // Cancelada a busca, a tarefa passa inteira para a lista de nós abertos
+            if (search_stopped())
+            {
+                memcpy(task_list_append(&result->open), tasks.blocks + (size_t)i * subproblem_ints, sizeof(int) * subproblem_ints);
+                continue;
+            }
+
+            double task_start = getClock();
+            long long start_nodes = ts->nodes;
+            ts->incumbent = round_incumbent;
+            ts->task_suspended = 0;
+            ts->flushed_nodes = ts->nodes;
+            ts->task_node_cap = ts->nodes + budget;
+            PROFILE(unsigned long long copy_start = profile_cycles();)
+            memcpy(ctx->state, tasks.blocks + (size_t)i * subproblem_ints, sizeof(int) * subproblem_ints);
+            Subproblem state = subproblem_view(ctx->state, instance_dims());
+            bound_engine_init(&ctx->engine, state.job_completion, state.job_next_op);
+            ctx->key = tt_state_key(state.job_next_op);
+            PROFILE(profile_add_cycles(ts->profile, PROFILE_STATE_COPY, copy_start);)
+            branch_and_bound(ctx);
+            if (ts->task_suspended)
+                collect_task_frontier(ctx, &result->open);
+
+            result->nodes = ts->nodes - start_nodes;
+            if (ts->incumbent < round_incumbent)
+            {
+                result->makespan = ts->incumbent;
+                result->schedule = (int *)checked_malloc(sizeof(int) * num_ops, "o modo deterministico");
+                memcpy(result->schedule, ts->schedules, sizeof(int) * num_ops);
+            }
+            busy_time += getClock() - task_start;
+        }
+        det_barrier_time += (getClock() - round_start) * num_workers - busy_time;
+
+        // Junta os resultados pela ordem das tarefas
+        TaskList next = {NULL, 0, 0};
+        for (long long i = 0; i < tasks.count; i++)
+        {
+            TaskResult *result = &results[i];
+            nodes_explored += result->nodes;
+            if (result->makespan < best_makespan)
+            {
+                best_makespan = result->makespan;
+                memcpy(best_schedule, result->schedule, sizeof(int) * num_ops);
+                record_incumbent_event(best_makespan, nodes_explored);
+                LOG(LOG_INFO, "Nova melhor solucao: makespan = %d (ronda %lld, tarefa %lld, nos: %lld)\n",
+                    best_makespan, det_rounds, i, nodes_explored);
+            }
+            for (long long k = 0; k < result->open.count; k++)
+            {
+                memcpy(task_list_append(&next), result->open.blocks + (size_t)k * subproblem_ints, sizeof(int) * subproblem_ints);
+            }
+            free(result->open.blocks);
+            free(result->schedule);
+        }
+        free(results);
+        free(tasks.blocks);
+        tasks = next;
+        det_rounds++;
+    }
+
+    // Os nós que ficaram por explorar limitam o lower bound global
+    ThreadState *ts = &thread_states[0];
+    Dims d = instance_dims();
+    for (long long i = 0; i < tasks.count; i++)
+    {
+        Subproblem sp = subproblem_view(tasks.blocks + (size_t)i * subproblem_ints, d);
+        bound_engine_init(&contexts[0]->engine, sp.job_completion, sp.job_next_op);
+        int lb = calculate_improved_lower_bound(&contexts[0]->engine, -1, sp.job_completion, sp.machine_completion, sp.job_next_op, d);
+        if (lb < ts->open_bound)
+            ts->open_bound = lb;
+    }
+    free(tasks.blocks);
+
+    best_incumbent = ((unsigned long long)best_makespan << 32) | INCUMBENT_HEURISTIC;
+    for (int t = 0; t < num_workers; t++)
+    {
+        search_context_destroy(contexts[t]);
+    }
+    free(contexts);
+}
+
+// Distribui a raiz pelos deques e executa a busca com roubo de trabalho
+void run_work_stealing_search(const int *root)
+{
+#ifdef _OPENMP
+    num_workers = omp_get_max_threads();
+#else
+    num_workers = 1;
+#endif
+    work_deques = (WorkDeque *)malloc(sizeof(WorkDeque) * num_workers);
+    if (!work_deques)
+    {
+        printf("ERRO: Memoria insuficiente para os deques de trabalho\n");
+        exit(1);
+    }
+    for (int t = 0; t < num_workers; t++)
+    {
+        work_deques[t].items = (int *)checked_malloc(sizeof(int) * subproblem_ints * WORK_DEQUE_CAPACITY, "os deques de trabalho");
+        work_deques[t].head = 0;
+        work_deques[t].tail = 0;
+#ifdef _OPENMP
+        omp_init_lock(&work_deques[t].lock);
+#endif
+    }
+
+    thread_states = (ThreadState *)checked_malloc(sizeof(ThreadState) * num_workers, "o estado das threads");
+    for (int t = 0; t < num_workers; t++)
+    {
+        thread_states[t].id = t;
+        thread_states[t].incumbent = best_makespan;
+        thread_states[t].published_buffer = -1;
+        thread_states[t].schedules = (int *)checked_malloc(sizeof(int) * 2 * num_ops, "o estado das threads");
+        thread_states[t].nodes = 0;
+        thread_states[t].flushed_nodes = 0;
+        thread_states[t].shared_nodes = nodes_explored;
+        thread_states[t].open_bound = INT_MAX;
+        thread_states[t].truncated_bound = INT_MAX;
+        thread_states[t].pool_fallbacks = 0;
+        for (int r = 0; r < NUM_DOMINANCE_RULES; r++)
+            thread_states[t].dominance_prunes[r] = 0;
+        thread_states[t].profile = NULL;
+#ifdef SEARCH_PROFILE
+        thread_states[t].profile = (long long *)checked_malloc(sizeof(long long) * profile_size(), "o perfil da busca");
+        memset(thread_states[t].profile, 0, sizeof(long long) * profile_size());
+#endif
+        thread_states[t].task_node_cap = LLONG_MAX;
+        thread_states[t].task_suspended = 0;
+        thread_states[t].checkpoint.data = NULL;
+        thread_states[t].checkpoint.size = 0;
+        thread_states[t].checkpoint.capacity = 0;
+        thread_states[t].checkpoint.records = 0;
+    }
+    best_incumbent = ((unsigned long long)best_makespan << 32) | INCUMBENT_HEURISTIC;
+
+    outstanding_work = 0;
+    idle_threads = 0;
+    active_workers = num_workers;
+    search_phase = (strategy_type == STRATEGY_BEST) ? PHASE_BEST : PHASE_DFS;
+    if (strategy_type != STRATEGY_DFS)
+        node_pool_init();
+    next_checkpoint_time = getClock() + checkpoint_interval;
+#ifdef USE_MPI
+    mpi_buffer = (int *)checked_malloc(sizeof(int) * subproblem_ints * MPI_STEAL_MAX, "as mensagens MPI");
+    mpi_known_makespan = best_makespan;
+    mpi_next_victim = (mpi_rank + 1) % mpi_size;
+    if (mpi_size > 1)
+        outstanding_work = mpi_split_root(); // Cada rank começa pela sua parte da raiz
+    else
+#endif
+    if (resume_count > 0)
+        outstanding_work = resume_count; // Os subproblemas do checkpoint substituem a raiz
+    else if (!resume_filename && !deterministic_mode)
+        deque_push(&work_deques[0], root);
+
+    // O modo determinístico usa as suas rondas em vez dos deques e do roubo de trabalho
+    if (deterministic_mode)
+    {
+        run_deterministic_search(root);
+    }
+    else
+    {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_workers)
+#endif
+        {
+            search_worker();
+        }
+    }
+#ifdef USE_MPI
+    mpi_finish_messages();
+    free(mpi_buffer);
+#endif
+
+    // Copia o escalonamento do incumbente final para best_schedule
+    unsigned long long slot = best_incumbent & INCUMBENT_HEURISTIC;
+    best_makespan = (int)(best_incumbent >> 32);
+    if (slot != INCUMBENT_HEURISTIC)
+    {
+        memcpy(best_schedule, thread_states[slot / 2].schedules + (slot % 2) * num_ops, sizeof(int) * num_ops);
+    }
+
+    global_lower_bound = compute_global_lower_bound();
+    node_pool_free();
+    for (int t = 0; t < num_workers; t++)
+    {
+        for (int r = 0; r < NUM_DOMINANCE_RULES; r++)
+            dominance_prunes[r] += thread_states[t].dominance_prunes[r];
+#ifdef SEARCH_PROFILE
+        if (!search_profile)
+        {
+            search_profile = (long long *)checked_malloc(sizeof(long long) * profile_size(), "o perfil da busca");
+            memset(search_profile, 0, sizeof(long long) * profile_size());
+        }
+        for (int k = 0; k < profile_size(); k++)
+            search_profile[k] += thread_states[t].profile[k];
+        free(thread_states[t].profile);
 #endif
+        free(thread_states[t].schedules);
+        free(thread_states[t].checkpoint.data);
     }
+    free(thread_states);
+    thread_states = NULL;
 
+    for (int t = 0; t < num_workers; t++)
+    {
 #ifdef _OPENMP
-    // Libera o lock após atualizar a melhor solução
-    omp_unset_lock(&best_lock);
+        omp_destroy_lock(&work_deques[t].lock);
 #endif
+        free(work_deques[t].items);
+    }
+    free(work_deques);
+    work_deques = NULL;
 }
 
-void branch_and_bound(int schedule[MAX_JOBS][MAX_MACHINES],
-                      int job_completion[],
-                      int machine_completion[],
-                      int job_next_op[],
-                      int depth)
+// Busca de referência, fora das medições da busca principal: parte do incumbente dado,
+// no modo indicado, e repõe depois o estado partilhado e o incumbente atual. Devolve os
+// nós explorados; o makespan final e o tempo (wall) ficam em makespan_out e wall.
+long long run_reference_search(const int *root, int start_makespan, const int *start_schedule, int deterministic,
+                               int *makespan_out, double *wall)
 {
-    // Limita o número total de nós explorados para evitar execuções muito longas
-    if (nodes_explored >= MAX_TOTAL_NODES)
-    {
-        return;
-    }
+    int saved_makespan = best_makespan;
+    int saved_mode = deterministic_mode;
+    int *saved_schedule = (int *)checked_malloc(sizeof(int) * num_ops, "a busca de referencia");
+    memcpy(saved_schedule, best_schedule, sizeof(int) * num_ops);
+    best_makespan = start_makespan;
+    memcpy(best_schedule, start_schedule, sizeof(int) * num_ops);
+    deterministic_mode = deterministic;
 
-    // Incrementa o contador de nós explorados de forma atômica em ambiente paralelo
-#ifdef _OPENMP
-#pragma omp atomic
-#endif
-    nodes_explored++;
+    search_start_time = getClock();
+    search_deadline = search_start_time + time_limit;
+    run_work_stealing_search(root);
+    long long nodes = nodes_explored;
+    *makespan_out = best_makespan;
+    *wall = getClock() - search_start_time;
 
-    // Periodicamente, imprime estatísticas de progresso (apenas pela thread 0 em paralelo)
-#ifdef _OPENMP
-    if (omp_get_thread_num() == 0 && nodes_explored % 5000000 == 0)
-    {
-        double elapsed = getClock() - global_start_time;
-        printf("Nos explorados: %lld/%lld, melhor makespan: %d, tempo: %.1fs\n",
-               nodes_explored, (long long)MAX_TOTAL_NODES, best_makespan, elapsed);
-    }
-#else
-    if (nodes_explored % 5000000 == 0)
-    {
-        double elapsed = getClock() - global_start_time;
-        printf("Nos explorados: %lld/%lld, melhor makespan: %d, tempo: %.1fs\n",
-               nodes_explored, (long long)MAX_TOTAL_NODES, best_makespan, elapsed);
-    }
-#endif
+    nodes_explored = 0;
+    search_stop = STOP_NONE;
+    timeline_size = 0;
+    steals_performed = 0;
+    subproblems_donated = 0;
+    pool_fallbacks = 0;
+    for (int r = 0; r < NUM_DOMINANCE_RULES; r++)
+        dominance_prunes[r] = 0;
+    if (search_profile)
+        memset(search_profile, 0, sizeof(long long) * profile_size());
+    phase_switch_time = -1;
+    phase_switch_nodes = 0;
+    det_rounds = 0;
+    det_tasks = 0;
+    det_barrier_time = 0;
+    tt_clear();
+    deterministic_mode = saved_mode;
+    best_makespan = saved_makespan;
+    memcpy(best_schedule, saved_schedule, sizeof(int) * num_ops);
+    free(saved_schedule);
+    return nodes;
+}
 
-    // Se todos os jobs estão completos, verifica e atualiza a melhor solução
-    if (all_jobs_complete(job_next_op))
+// Nome de um ficheiro do perfil: o do ficheiro de métricas sem extensão mais o sufixo
+void profile_filename(char *name, size_t size, const char *metrics_filename, const char *suffix)
+{
+    snprintf(name, size, "%s", metrics_filename);
+    char *dot = strrchr(name, '.');
+    char *slash = strrchr(name, '/');
+    if (dot && (!slash || dot > slash))
+        *dot = '\0';
+    size_t length = strlen(name);
+    snprintf(name + length, size - length, "%s", suffix);
+}
+
+FILE *open_profile_file(const char *metrics_filename, const char *suffix)
+{
+    char name[1024];
+    profile_filename(name, sizeof(name), metrics_filename, suffix);
+    FILE *file = fopen(name, "w");
+    if (!file)
+        printf("Erro ao criar ficheiro do perfil: %s\n", name);
+    return file;
+}
+
+// Escreve o perfil somado em três CSV ao lado do ficheiro de métricas: nós e podas
+// por profundidade, distribuição de lower bound / incumbente e ciclos por fase
+void write_search_profile(const char *metrics_filename)
+{
+    FILE *file = open_profile_file(metrics_filename, "_perfil_profundidade.csv");
+    if (file)
     {
-        int makespan = 0;
-        for (int j = 0; j < num_jobs; j++)
+        fprintf(file, "profundidade");
+        for (int c = 0; c < PROFILE_COLUMNS; c++)
+            fprintf(file, ",%s", profile_column_names[c]);
+        fprintf(file, "\n");
+        for (int depth = 0; depth <= num_ops; depth++)
         {
-            if (job_completion[j] > makespan)
-                makespan = job_completion[j];
+            fprintf(file, "%d", depth);
+            for (int c = 0; c < PROFILE_COLUMNS; c++)
+                fprintf(file, ",%lld", search_profile[depth * PROFILE_COLUMNS + c]);
+            fprintf(file, "\n");
         }
-
-        printf("Solucao completa encontrada: makespan = %d (nos: %lld)\n", makespan, nodes_explored);
-        update_best_solution(schedule, makespan);
-        return;
+        fclose(file);
     }
 
-    // Limita a profundidade máxima da busca para evitar loops infinitos
-    int max_reasonable_depth = num_jobs * num_machines;
-    if (depth > max_reasonable_depth)
+    file = open_profile_file(metrics_filename, "_perfil_bound.csv");
+    if (file)
     {
-        return;
+        // O último intervalo (lower bound >= incumbente) corresponde aos nós podados
+        fprintf(file, "razao_min_pct,razao_max_pct,nos\n");
+        const long long *buckets = &search_profile[profile_bound_offset()];
+        for (int b = 0; b < PROFILE_BOUND_BUCKETS; b++)
+            fprintf(file, "%d,%d,%lld\n", b * 100 / PROFILE_BOUND_BUCKETS, (b + 1) * 100 / PROFILE_BOUND_BUCKETS, buckets[b]);
+        fprintf(file, "100,,%lld\n", buckets[PROFILE_BOUND_BUCKETS]);
+        fclose(file);
     }
 
-    // Calcula um lower bound para o makespan a partir do estado atual
-    int lower_bound = calculate_improved_lower_bound(job_completion, machine_completion, job_next_op);
-    if (lower_bound >= best_makespan)
+    file = open_profile_file(metrics_filename, "_perfil_ciclos.csv");
+    if (file)
     {
-        // Poda: não vale a pena explorar este ramo
-        return;
+        const long long *cycles = &search_profile[profile_cycles_offset()];
+        long long total = 0;
+        for (int p = 0; p < NUM_PROFILE_PHASES; p++)
+            total += cycles[p];
+        fprintf(file, "fase,ciclos,percentagem\n");
+        for (int p = 0; p < NUM_PROFILE_PHASES; p++)
+            fprintf(file, "%s,%lld,%.2f\n", profile_phase_names[p], cycles[p], total > 0 ? 100.0 * cycles[p] / total : 0.0);
+        fclose(file);
     }
+}
 
-    // Estrutura para armazenar informações dos jobs disponíveis para ramificação
-    typedef struct
+void print_usage(const char *program)
+{
+    printf("Uso: %s <input_file> <output_file> <metrics_file> [opcoes]\n", program);
+    printf("Exemplo: %s input/05.jss output/bnb_par.txt output/bnb_par_metrics.txt\n", program);
+    printf("Opcoes:\n");
+    printf("  --bound=simple|jackson   lower bound usado na poda (por omissao: simple)\n");
+    printf("  --branching=all|active   ramificacao em todos os jobs ou so em escalonamentos ativos (por omissao: all)\n");
+    printf("  --tt-size=N              entradas da tabela de transposicao (0 desativa, por omissao: 0)\n");
+    printf("  --heuristic=index|portfolio  incumbente inicial: ordem dos jobs ou portfolio de regras de despacho (por omissao: portfolio)\n");
+    printf("  --heuristic-baseline     corre antes a busca a partir da heuristica por indice e indica os nos poupados\n");
+    printf("  --dominance=all|none|commute|idle  regras de dominancia na ramificacao (por omissao: all)\n");
+    printf("  --search=exact|beam|lds  exata, feixe com largura por profundidade ou limited discrepancy search (por omissao: beam)\n");
+    printf("  --beam-widths=P:L,...,L  larguras do feixe: L abaixo da profundidade P, a ultima nas restantes, all = sem limite\n");
+    printf("                           (por omissao: %s em beam, all em lds)\n", DEFAULT_BEAM_WIDTHS);
+    printf("  --lds-discrepancies=K    discrepancias por caminho em lds; o i-esimo filho custa i (por omissao: 3)\n");
+    printf("  --log=quiet|info|debug   mensagens durante a busca; debug inclui cada solucao completa (por omissao: info)\n");
+    printf("  --simd=auto|scalar|avx2  nucleo do bound por job; auto usa AVX2 se o CPU o suportar (por omissao: auto)\n");
+    printf("  --bench-bound[=N]        so corre o microbenchmark escalar vs AVX2 do bound com N avaliacoes (por omissao: 1000000)\n");
+    printf("  --strategy=dfs|best|hybrid  ordem de exploracao (por omissao: dfs)\n");
+    printf("  --pool-mb=N              memoria maxima do pool de nos de best/hybrid em MB (por omissao: 256)\n");
+    printf("  --deterministic          rondas sincronizadas: nos e incumbentes reprodutiveis para o mesmo numero de threads\n");
+    printf("  --deterministic-compare  como --deterministic, mas corre antes a busca livre e indica o custo\n");
+    printf("  --time-limit=S           termina a busca ao fim de S segundos (0 = sem limite, por omissao: 0)\n");
+    printf("  --node-limit=N           termina a busca ao fim de N nos (por omissao: %lld)\n", MAX_TOTAL_NODES);
+    printf("  --checkpoint=FICHEIRO    guarda periodicamente a fronteira de busca neste ficheiro\n");
+    printf("  --checkpoint-interval=S  segundos entre checkpoints (por omissao: 10)\n");
+    printf("  --resume=FICHEIRO        continua a busca a partir de um checkpoint\n");
+}
+
+// Lê as larguras do feixe no formato "P1:L1,P2:L2,...,L": largura L1 abaixo da
+// profundidade P1, L2 abaixo de P2, ... e L nas restantes; "all" é sem limite.
+// Devolve 0 se a especificação for inválida.
+int parse_beam_widths(const char *spec)
+{
+    const char *p = spec;
+    int levels = 0;
+    for (;;)
     {
-        int job;
-        int priority_score;
-        int remaining_time;
-        int duration;
-        int earliest_start;
-        int machine;
-        int op;
-    } JobInfo;
+        if (levels == MAX_BEAM_LEVELS)
+            return 0;
 
-    JobInfo available_jobs[MAX_JOBS];
-    int num_available = 0;
+        // Profundidade opcional antes de ':'
+        char *end;
+        long depth = INT_MAX;
+        const char *colon = strchr(p, ':');
+        const char *comma = strchr(p, ',');
+        if (colon && (!comma || colon < comma))
+        {
+            depth = strtol(p, &end, 10);
+            if (end != colon || depth <= 0 || (levels > 0 && depth <= beam_depths[levels - 1]))
+                return 0;
+            p = colon + 1;
+        }
 
-    // Identifica todos os jobs que ainda têm operações a serem agendadas
-    for (int j = 0; j < num_jobs; j++)
-    {
-        if (job_next_op[j] < num_machines)
+        long width;
+        if (strncmp(p, "all", 3) == 0)
         {
-            int op = job_next_op[j];
-            int machine = job_machine[j][op];
-            int duration = job_duration[j][op];
-            int earliest_start = (job_completion[j] > machine_completion[machine]) ? job_completion[j] : machine_completion[machine];
+            width = 0;
+            end = (char *)p + 3;
+        }
+        else
+        {
+            width = strtol(p, &end, 10);
+            if (end == p || width <= 0)
+                return 0;
+        }
+        beam_depths[levels] = (int)depth;
+        beam_widths[levels] = (int)width;
+        levels++;
 
-            available_jobs[num_available].job = j;
-            available_jobs[num_available].remaining_time = job_remaining_time[j][op];
-            available_jobs[num_available].duration = duration;
-            available_jobs[num_available].earliest_start = earliest_start;
-            available_jobs[num_available].machine = machine;
-            available_jobs[num_available].op = op;
+        if (*end == '\0')
+            break;
+        if (*end != ',' || depth == INT_MAX)
+            return 0;
+        p = end + 1;
+    }
 
-            // Calcula uma prioridade para o job com base em urgência, gargalo e duração
-            int urgency = job_remaining_time[j][op];
-            int bottleneck = 0;
+    // A última largura tem de valer para todas as profundidades restantes
+    if (beam_depths[levels - 1] != INT_MAX)
+        return 0;
+    beam_levels = levels;
+    return 1;
+}
 
-            // Conta quantas operações restantes usam a mesma máquina (gargalo)
-            for (int other_j = 0; other_j < num_jobs; other_j++)
+// Lê as opções opcionais que seguem os três ficheiros; devolve 0 se alguma for inválida
+int parse_options(int argc, char **argv)
+{
+    for (int i = 4; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--bound=simple") == 0)
+        {
+            bound_type = BOUND_SIMPLE;
+        }
+        else if (strcmp(arg, "--bound=jackson") == 0)
+        {
+            bound_type = BOUND_JACKSON;
+        }
+        else if (strcmp(arg, "--branching=all") == 0)
+        {
+            branching_type = BRANCHING_ALL;
+        }
+        else if (strcmp(arg, "--branching=active") == 0)
+        {
+            branching_type = BRANCHING_ACTIVE;
+        }
+        else if (strncmp(arg, "--tt-size=", 10) == 0)
+        {
+            char *end;
+            tt_requested_entries = strtoll(arg + 10, &end, 10);
+            if (*end != '\0' || tt_requested_entries < 0)
             {
-                for (int other_op = job_next_op[other_j]; other_op < num_machines; other_op++)
-                {
-                    if (job_machine[other_j][other_op] == machine)
-                        bottleneck++;
-                }
+                printf("ERRO: Tamanho invalido da tabela de transposicao: %s\n", arg + 10);
+                return 0;
             }
-
-            available_jobs[num_available].priority_score = urgency * 100 + bottleneck * 20 + duration * 5;
-            num_available++;
         }
-    }
-
-    // Ordena os jobs disponíveis por prioridade (maior score primeiro)
-    for (int i = 0; i < num_available - 1; i++)
-    {
-        for (int k = i + 1; k < num_available; k++)
+        else if (strcmp(arg, "--heuristic=index") == 0)
+        {
+            heuristic_type = HEURISTIC_INDEX;
+        }
+        else if (strcmp(arg, "--heuristic=portfolio") == 0)
+        {
+            heuristic_type = HEURISTIC_PORTFOLIO;
+        }
+        else if (strcmp(arg, "--heuristic-baseline") == 0)
+        {
+            heuristic_baseline = 1;
+        }
+        else if (strcmp(arg, "--deterministic") == 0)
+        {
+            deterministic_mode = 1;
+        }
+        else if (strcmp(arg, "--deterministic-compare") == 0)
+        {
+            deterministic_mode = 1;
+            deterministic_compare = 1;
+        }
+        else if (strcmp(arg, "--dominance=all") == 0)
+        {
+            dominance_mask = (1 << NUM_DOMINANCE_RULES) - 1;
+        }
+        else if (strcmp(arg, "--dominance=none") == 0)
+        {
+            dominance_mask = 0;
+        }
+        else if (strcmp(arg, "--dominance=commute") == 0)
         {
-            if (available_jobs[k].priority_score > available_jobs[i].priority_score)
+            dominance_mask = 1 << DOMINANCE_COMMUTE;
+        }
+        else if (strcmp(arg, "--dominance=idle") == 0)
+        {
+            dominance_mask = 1 << DOMINANCE_IDLE;
+        }
+        else if (strcmp(arg, "--search=exact") == 0)
+        {
+            search_mode = SEARCH_EXACT;
+        }
+        else if (strcmp(arg, "--search=beam") == 0)
+        {
+            search_mode = SEARCH_BEAM;
+        }
+        else if (strcmp(arg, "--search=lds") == 0)
+        {
+            search_mode = SEARCH_LDS;
+        }
+        else if (strncmp(arg, "--beam-widths=", 14) == 0)
+        {
+            beam_spec = arg + 14;
+            beam_spec_given = 1;
+        }
+        else if (strncmp(arg, "--lds-discrepancies=", 20) == 0)
+        {
+            char *end;
+            lds_max_discrepancies = (int)strtol(arg + 20, &end, 10);
+            if (*end != '\0' || lds_max_discrepancies < 0)
             {
-                JobInfo temp = available_jobs[i];
-                available_jobs[i] = available_jobs[k];
-                available_jobs[k] = temp;
+                printf("ERRO: Numero invalido de discrepancias: %s\n", arg + 20);
+                return 0;
             }
         }
-    }
-
-    // Define o número máximo de ramos a explorar, reduzindo conforme a profundidade aumenta
-    int max_branches;
-    if (depth < 15)
-        max_branches = num_available;
-    else if (depth < 20)
-        max_branches = (num_available > 3) ? 3 : num_available;
-    else
-        max_branches = (num_available > 2) ? 2 : num_available;
-
-    // Paraleliza a ramificação nos primeiros níveis da árvore de busca
-#ifdef _OPENMP
-#pragma omp parallel for if (depth <= 6 && max_branches > 1) schedule(dynamic)
-#endif
-    for (int i = 0; i < max_branches; i++)
-    {
-        // Garante que não ultrapasse o limite de nós explorados
-        if (nodes_explored >= MAX_TOTAL_NODES)
+        else if (strcmp(arg, "--log=quiet") == 0)
         {
-            continue;
+            log_level = LOG_QUIET;
         }
-
-        int j = available_jobs[i].job;
-        int op = available_jobs[i].op;
-        int machine = available_jobs[i].machine;
-        int duration = available_jobs[i].duration;
-        int start_time = available_jobs[i].earliest_start;
-        int end_time = start_time + duration;
-
-        // Cria cópias dos vetores para o novo estado
-        int new_schedule[MAX_JOBS][MAX_MACHINES];
-        int new_job_completion[MAX_JOBS];
-        int new_machine_completion[MAX_MACHINES];
-        int new_job_next_op[MAX_JOBS];
-
-        for (int jj = 0; jj < num_jobs; jj++)
+        else if (strcmp(arg, "--log=info") == 0)
+        {
+            log_level = LOG_INFO;
+        }
+        else if (strcmp(arg, "--log=debug") == 0)
+        {
+            log_level = LOG_DEBUG;
+        }
+        else if (strcmp(arg, "--simd=auto") == 0)
+        {
+            simd_type = SIMD_AUTO;
+        }
+        else if (strcmp(arg, "--simd=scalar") == 0)
+        {
+            simd_type = SIMD_SCALAR;
+        }
+        else if (strcmp(arg, "--simd=avx2") == 0)
+        {
+            simd_type = SIMD_AVX2;
+        }
+        else if (strcmp(arg, "--bench-bound") == 0)
+        {
+            bench_evaluations = 1000000;
+        }
+        else if (strncmp(arg, "--bench-bound=", 14) == 0)
         {
-            new_job_completion[jj] = job_completion[jj];
-            new_job_next_op[jj] = job_next_op[jj];
-            for (int oo = 0; oo < num_machines; oo++)
+            char *end;
+            bench_evaluations = strtoll(arg + 14, &end, 10);
+            if (*end != '\0' || bench_evaluations <= 0)
             {
-                new_schedule[jj][oo] = schedule[jj][oo];
+                printf("ERRO: Numero invalido de avaliacoes do microbenchmark: %s\n", arg + 14);
+                return 0;
             }
         }
-        for (int m = 0; m < num_machines; m++)
+        else if (strcmp(arg, "--strategy=dfs") == 0)
         {
-            new_machine_completion[m] = machine_completion[m];
+            strategy_type = STRATEGY_DFS;
+        }
+        else if (strcmp(arg, "--strategy=best") == 0)
+        {
+            strategy_type = STRATEGY_BEST;
+        }
+        else if (strcmp(arg, "--strategy=hybrid") == 0)
+        {
+            strategy_type = STRATEGY_HYBRID;
+        }
+        else if (strncmp(arg, "--pool-mb=", 10) == 0)
+        {
+            char *end;
+            pool_memory_mb = strtoll(arg + 10, &end, 10);
+            if (*end != '\0' || pool_memory_mb <= 0)
+            {
+                printf("ERRO: Memoria invalida para o pool de nos: %s\n", arg + 10);
+                return 0;
+            }
+        }
+        else if (strncmp(arg, "--time-limit=", 13) == 0)
+        {
+            char *end;
+            time_limit = strtod(arg + 13, &end);
+            if (*end != '\0' || time_limit < 0)
+            {
+                printf("ERRO: Limite de tempo invalido: %s\n", arg + 13);
+                return 0;
+            }
+        }
+        else if (strncmp(arg, "--node-limit=", 13) == 0)
+        {
+            char *end;
+            node_limit = strtoll(arg + 13, &end, 10);
+            if (*end != '\0' || node_limit <= 0)
+            {
+                printf("ERRO: Limite de nos invalido: %s\n", arg + 13);
+                return 0;
+            }
+        }
+        else if (strncmp(arg, "--checkpoint=", 13) == 0 && arg[13] != '\0')
+        {
+            checkpoint_filename = arg + 13;
+        }
+        else if (strncmp(arg, "--checkpoint-interval=", 22) == 0)
+        {
+            char *end;
+            checkpoint_interval = strtod(arg + 22, &end);
+            if (*end != '\0' || checkpoint_interval <= 0)
+            {
+                printf("ERRO: Intervalo de checkpoint invalido: %s\n", arg + 22);
+                return 0;
+            }
+        }
+        else if (strncmp(arg, "--resume=", 9) == 0 && arg[9] != '\0')
+        {
+            resume_filename = arg + 9;
+        }
+        else
+        {
+            printf("ERRO: Opcao desconhecida: %s\n", arg);
+            return 0;
         }
-
-        // Atualiza o novo estado com a operação escolhida
-        new_schedule[j][op] = start_time;
-        new_job_completion[j] = end_time;
-        new_machine_completion[machine] = end_time;
-        new_job_next_op[j]++;
-
-        // Chama recursivamente para o novo estado
-        branch_and_bound(new_schedule, new_job_completion, new_machine_completion,
-                         new_job_next_op, depth + 1);
     }
+    return 1;
 }
 
 int main(int argc, char **argv)
 {
+#ifdef USE_MPI
+    // Só a thread 0 de cada rank chama MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+#endif
+
     // Verifica se o número de argumentos está correto
-    if (argc != 4)
+    if (argc < 4 || !parse_options(argc, argv))
     {
-        printf("Uso: %s <input_file> <output_file> <metrics_file>\n", argv[0]);
-        printf("Exemplo: %s input/05.jss output/bnb_par.txt output/bnb_par_metrics.txt\n", argv[0]);
+        if (mpi_rank == 0)
+            print_usage(argv[0]);
+#ifdef USE_MPI
+        MPI_Finalize();
+#endif
         return 1;
     }
 
+    // Larguras do feixe; no LDS, sem limite se não forem indicadas
+    if (search_mode == SEARCH_LDS && !beam_spec_given)
+        beam_spec = "all";
+    if (!parse_beam_widths(beam_spec))
+    {
+        printf("ERRO: Larguras do feixe invalidas: %s\n", beam_spec);
+        exit(1);
+    }
+
     // Lê os nomes dos ficheiros a partir dos argumentos
     const char *input_filename = argv[1];
     const char *output_filename = argv[2];
@@ -484,70 +5026,175 @@ int main(int argc, char **argv)
     // Lê os dados do problema do ficheiro de entrada
     read_input(input_filename);
 
+    // Escolhe o núcleo do bound por job pelo CPUID; o microbenchmark termina aqui
+    select_bound_kernel();
+    if (bench_evaluations > 0)
+    {
+        if (mpi_rank == 0)
+            run_bound_benchmark(bench_evaluations);
+#ifdef USE_MPI
+        MPI_Finalize();
+#endif
+        return 0;
+    }
+
+    // Gera as chaves Zobrist e reserva a tabela de transposição, se pedida
+    tt_init(tt_requested_entries);
+
+    if (mpi_rank == 0)
+    {
 #ifdef _OPENMP
-    // Inicializa o lock para acesso concorrente à melhor solução
-    omp_init_lock(&best_lock);
-    printf("=== BALANCED PARALLEL BRANCH AND BOUND (FIXED NODE LIMIT) ===\n");
-    printf("Threads disponiveis: %d\n", omp_get_max_threads());
-    printf("Limite TOTAL de nos: %dM (fixo, nao por thread)\n", MAX_TOTAL_NODES / 1000000);
+        printf("=== WORK-STEALING PARALLEL BRANCH AND BOUND ===\n");
+        printf("Threads disponiveis: %d\n", omp_get_max_threads());
+        printf("Limite total de nos: %lld (partilhado, nao por thread)\n", node_limit);
 #else
-    printf("=== BALANCED BRANCH AND BOUND PARA JOB SHOP ===\n");
-    printf("Limite total de nos: %dM\n", MAX_TOTAL_NODES / 1000000);
+        printf("=== BALANCED BRANCH AND BOUND PARA JOB SHOP ===\n");
+        printf("Limite total de nos: %lld\n", node_limit);
+#endif
+#ifdef USE_MPI
+        printf("Processos MPI: %d\n", mpi_size);
 #endif
-    printf("Ficheiro de entrada: %s\n", input_filename);
-    printf("Ficheiro de saida: %s\n", output_filename);
-    printf("Ficheiro de metricas: %s\n\n", metrics_filename);
+        if (time_limit > 0)
+            printf("Limite de tempo: %.1f segundos\n", time_limit);
+        printf("Lower bound: %s\n", bound_names[bound_type]);
+        printf("Ramificacao: %s\n", branching_names[branching_type]);
+        printf("Modo de busca: %s\n", search_mode_names[search_mode]);
+        printf("Estrategia: %s\n", strategy_names[strategy_type]);
+        printf("Nucleo do bound por job: %s\n", bound_kernel_name);
+        printf("Tabela de transposicao: %lld entradas\n", tt_num_entries());
+        printf("Ficheiro de entrada: %s\n", input_filename);
+        printf("Ficheiro de saida: %s\n", output_filename);
+        printf("Ficheiro de metricas: %s\n\n", metrics_filename);
+    }
 
-    // Calcula o upper bound inicial usando uma heurística
-    best_makespan = get_initial_upper_bound();
-    printf("Upper bound inicial (heuristica): %d\n", best_makespan);
+    // Calcula o upper bound inicial e o escalonamento correspondente com o portfólio de
+    // regras de despacho (ou só com a heurística original)
+    run_heuristic_portfolio();
+    if (mpi_rank == 0)
+    {
+        if (heuristic_winner == RULE_RANDOM)
+            printf("Upper bound inicial (heuristica %s, semente %d): %d\n", rule_names[heuristic_winner], heuristic_winner_seed, best_makespan);
+        else
+            printf("Upper bound inicial (heuristica %s): %d\n", rule_names[heuristic_winner], best_makespan);
+        if (heuristic_type == HEURISTIC_PORTFOLIO)
+            printf("Portfolio: %d regras em %.4f segundos, heuristica por indice: %d\n", heuristic_runs, heuristic_time, index_makespan);
+    }
 
-    // Gera o escalonamento heurístico inicial e guarda na variavel best_schedule
-    int temp_job_completion[MAX_JOBS] = {0};
-    int temp_machine_completion[MAX_MACHINES] = {0};
+    // Inicializa o subproblema raiz para o algoritmo Branch and Bound
+    int *root_block = (int *)checked_malloc(sizeof(int) * subproblem_ints, "o subproblema raiz");
+    Subproblem root = subproblem_view(root_block, instance_dims());
     for (int j = 0; j < num_jobs; j++)
     {
+        root.job_completion[j] = 0;
+        root.job_next_op[j] = 0;
         for (int op = 0; op < num_machines; op++)
         {
-            int machine = job_machine[j][op];
-            int duration = job_duration[j][op];
-            int start_time = (temp_job_completion[j] > temp_machine_completion[machine]) ? temp_job_completion[j] : temp_machine_completion[machine];
-
-            best_schedule[j][op] = start_time;
-            temp_job_completion[j] = start_time + duration;
-            temp_machine_completion[machine] = start_time + duration;
+            root.schedule[j * num_machines + op] = -1;
         }
     }
+    for (int m = 0; m < num_machines; m++)
+    {
+        root.machine_completion[m] = 0;
+    }
+    *root.depth = 0;
+    *root.discrepancies = 0;
+    *root.last_job = -1;
 
-    // Inicializa as estruturas para o algoritmo Branch and Bound
-    int schedule[MAX_JOBS][MAX_MACHINES];
-    int job_completion[MAX_JOBS];
-    int machine_completion[MAX_MACHINES];
-    int job_next_op[MAX_JOBS];
+    // Os prefixos dos registos do checkpoint guardam o comprimento em 16 bits
+    if ((checkpoint_filename || resume_filename) && num_ops > 65535)
+    {
+        printf("ERRO: Checkpoints so suportam instancias com ate 65535 operacoes\n");
+        exit(1);
+    }
 
-    for (int j = 0; j < num_jobs; j++)
+#ifdef USE_MPI
+    // A fronteira de um checkpoint é a de um único processo
+    if ((checkpoint_filename || resume_filename) && mpi_size > 1)
     {
-        job_completion[j] = 0;
-        job_next_op[j] = 0;
-        for (int op = 0; op < num_machines; op++)
-        {
-            schedule[j][op] = -1;
-        }
+        printf("ERRO: --checkpoint e --resume nao suportam mais do que um processo MPI\n");
+        exit(1);
     }
-    for (int m = 0; m < num_machines; m++)
+
+    // O limite de nós é do conjunto dos ranks: cada um recebe uma parte igual
+    mpi_total_node_limit = node_limit;
+    node_limit = (node_limit + mpi_size - 1) / mpi_size;
+#endif
+
+    // A busca de referência repete a busca inteira, o que não se combina com checkpoints
+    if ((heuristic_baseline || deterministic_compare) && (checkpoint_filename || resume_filename || mpi_size > 1))
+    {
+        printf("ERRO: --heuristic-baseline e --deterministic-compare nao podem ser usados com --checkpoint, --resume ou varios processos MPI\n");
+        exit(1);
+    }
+
+    // As rondas determinísticas só cobrem a DFS sem estado partilhado entre tarefas
+    if (deterministic_mode && (strategy_type != STRATEGY_DFS || tt_num_entries() > 0 || checkpoint_filename ||
+                               resume_filename || mpi_size > 1))
+    {
+        printf("ERRO: --deterministic so suporta --strategy=dfs, sem tabela de transposicao, checkpoints nem MPI\n");
+        exit(1);
+    }
+
+    // A ramificação ativa já só gera escalonamentos ativos, e a tabela de transposição
+    // já poda as transposições; a regra da comutação depende do caminho até ao estado,
+    // o que não se combina com a poda por estados já expandidos
+    if (branching_type == BRANCHING_ACTIVE)
+        dominance_mask = 0;
+    if (tt_num_entries() > 0)
+        dominance_mask &= ~(1 << DOMINANCE_COMMUTE);
+
+    // As discrepâncias de um caminho não ficam nos registos do checkpoint nem na divisão
+    // da raiz pelos ranks
+    if (search_mode == SEARCH_LDS && (checkpoint_filename || resume_filename || mpi_size > 1))
+    {
+        printf("ERRO: --search=lds nao suporta checkpoints nem varios processos MPI\n");
+        exit(1);
+    }
+
+    // Continua uma busca anterior: o incumbente, os contadores e a fronteira vêm do ficheiro
+    if (resume_filename)
+        read_checkpoint(resume_filename);
+    int initial_makespan = best_makespan;
+
+    // Escolhe o núcleo de busca especializado para as dimensões da instância
+    select_search_kernel();
+    if (mpi_rank == 0)
+    {
+        printf("Nucleo de busca: %s\n", search_kernel_name);
+        printf("Iniciando Optimized Branch and Bound...\n");
+        printf("Heuristica guardada como solucao inicial.\n");
+    }
+
+    // As mensagens das buscas passam pelo registo assíncrono
+    log_start();
+
+    // Busca de referência a partir da heurística original, fora das medições de tempo
+    if (heuristic_baseline)
     {
-        machine_completion[m] = 0;
+        LOG(LOG_INFO, "Busca de referencia a partir da heuristica por indice (makespan %d)...\n", index_makespan);
+        baseline_nodes = run_reference_search(root_block, index_makespan, index_schedule, deterministic_mode,
+                                              &baseline_makespan, &baseline_wall);
+        LOG(LOG_INFO, "Busca de referencia: makespan %d, %lld nos\n", baseline_makespan, baseline_nodes);
     }
 
-    printf("Iniciando Optimized Branch and Bound...\n");
-    printf("Heuristica guardada como solucao inicial.\n");
+    // Busca livre com o mesmo incumbente inicial, para medir o custo do modo determinístico
+    if (deterministic_compare)
+    {
+        LOG(LOG_INFO, "Busca livre de referencia (sem modo deterministico)...\n");
+        free_nodes = run_reference_search(root_block, best_makespan, best_schedule, 0, &free_makespan, &free_wall);
+        LOG(LOG_INFO, "Busca livre: makespan %d, %lld nos, %.4f segundos\n", free_makespan, free_nodes, free_wall);
+    }
 
     // Marca o tempo de início da execução do Branch and Bound (CPU e wall clock)
     clock_t start_time = clock();
     double wall_start = getClock();
+    search_start_time = wall_start;
+    search_deadline = wall_start + time_limit;
 
-    // Executa o algoritmo Branch and Bound
-    branch_and_bound(schedule, job_completion, machine_completion, job_next_op, 0);
+    // Executa o algoritmo Branch and Bound com roubo de trabalho entre threads
+    run_work_stealing_search(root_block);
+    free(root_block);
+    log_stop();
 
     // Marca o tempo de término
     clock_t end_time = clock();
@@ -555,9 +5202,21 @@ int main(int argc, char **argv)
     double elapsed = (double)(end_time - start_time) / CLOCKS_PER_SEC;
     double wall_elapsed = wall_end - wall_start;
 
-#ifdef _OPENMP
-    // Destroi o lock após o uso
-    omp_destroy_lock(&best_lock);
+#ifdef USE_MPI
+    // O rank 0 escreve os resultados de todos; o tempo de CPU é a soma dos ranks
+    mpi_collect_results();
+    double rank_elapsed = elapsed;
+    MPI_Reduce(&rank_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (mpi_rank != 0)
+    {
+        tt_free();
+        free(resume_nodes);
+        free(resume_jobs);
+        free(incumbent_timeline);
+        free(search_profile);
+        MPI_Finalize();
+        return 0;
+    }
 #endif
 
     // Guarda o melhor escalonamento encontrado no ficheiro de saída
@@ -569,7 +5228,7 @@ int main(int argc, char **argv)
         {
             for (int op = 0; op < num_machines; op++)
             {
-                fprintf(output, "%d ", best_schedule[j][op]);
+                fprintf(output, "%d ", best_schedule[j * num_machines + op]);
             }
             fprintf(output, "\n");
         }
@@ -588,12 +5247,142 @@ int main(int argc, char **argv)
         fprintf(metrics, "Tempo de execucao (Wall): %.4f segundos\n", wall_elapsed);
         fprintf(metrics, "Makespan: %d\n", best_makespan);
         fprintf(metrics, "Nos explorados: %lld\n", nodes_explored);
-        fprintf(metrics, "Limite total de nos: %d\n", MAX_TOTAL_NODES);
+        fprintf(metrics, "Limite total de nos: %lld\n", node_limit);
+        if (time_limit > 0)
+            fprintf(metrics, "Limite de tempo: %.4f segundos\n", time_limit);
+        else
+            fprintf(metrics, "Limite de tempo: sem limite\n");
+        fprintf(metrics, "Paragem: %s\n", stop_names[search_stop]);
+        fprintf(metrics, "Lower bound global: %d\n", global_lower_bound);
+        fprintf(metrics, "Gap: %.2f%%\n", 100.0 * (best_makespan - global_lower_bound) / best_makespan);
+        fprintf(metrics, "Otimo provado: %s\n", global_lower_bound >= best_makespan ? "sim" : "nao");
+        fprintf(metrics, "Incumbente inicial: %d\n", initial_makespan);
+        fprintf(metrics, "Heuristica inicial: %s\n", heuristic_names[heuristic_type]);
+        if (heuristic_winner == RULE_RANDOM)
+            fprintf(metrics, "Regra vencedora: %s (semente %d)\n", rule_names[heuristic_winner], heuristic_winner_seed);
+        else
+            fprintf(metrics, "Regra vencedora: %s\n", rule_names[heuristic_winner]);
+        fprintf(metrics, "Makespan da heuristica por indice: %d\n", index_makespan);
+        fprintf(metrics, "Regras avaliadas: %d\n", heuristic_runs);
+        fprintf(metrics, "Tempo das heuristicas: %.4f segundos\n", heuristic_time);
+        if (heuristic_baseline)
+        {
+            fprintf(metrics, "Nos com a heuristica por indice: %lld\n", baseline_nodes);
+            fprintf(metrics, "Nos poupados pela heuristica inicial: %lld (%.2f%%)\n", baseline_nodes - nodes_explored,
+                    baseline_nodes > 0 ? 100.0 * (baseline_nodes - nodes_explored) / baseline_nodes : 0.0);
+        }
+        if (timeline_size > 0)
+        {
+            fprintf(metrics, "Tempo ate primeiro incumbente: %.4f segundos\n", incumbent_timeline[0].time);
+            fprintf(metrics, "Tempo ate melhor incumbente: %.4f segundos\n", incumbent_timeline[timeline_size - 1].time);
+        }
+        else
+        {
+            fprintf(metrics, "Tempo ate primeiro incumbente: nenhum (a busca nao melhorou a heuristica)\n");
+        }
+        for (int e = 0; e < timeline_size; e++)
+        {
+            fprintf(metrics, "Incumbente: t=%.4f makespan=%d nos=%lld\n", incumbent_timeline[e].time,
+                    incumbent_timeline[e].makespan, incumbent_timeline[e].nodes);
+        }
         fprintf(metrics, "Ficheiro de entrada: %s\n", input_filename);
+        fprintf(metrics, "Lower bound: %s\n", bound_names[bound_type]);
+        fprintf(metrics, "Ramificacao: %s\n", branching_names[branching_type]);
+        fprintf(metrics, "Modo de busca: %s\n", search_mode_names[search_mode]);
+        if (search_mode != SEARCH_EXACT)
+            fprintf(metrics, "Larguras do feixe: %s\n", beam_spec);
+        if (search_mode == SEARCH_LDS)
+            fprintf(metrics, "Discrepancias maximas: %d\n", lds_max_discrepancies);
+        for (int r = 0; r < NUM_DOMINANCE_RULES; r++)
+        {
+            if (dominance_mask & (1 << r))
+                fprintf(metrics, "Podas por dominancia (%s): %lld\n", dominance_names[r], dominance_prunes[r]);
+            else
+                fprintf(metrics, "Podas por dominancia (%s): desativada\n", dominance_names[r]);
+        }
+        fprintf(metrics, "Nucleo de busca: %s\n", search_kernel_name);
+        fprintf(metrics, "Nucleo do bound por job: %s\n", bound_kernel_name);
+        fprintf(metrics, "Estrategia: %s\n", strategy_names[strategy_type]);
+        fprintf(metrics, "Modo deterministico: %s\n", deterministic_mode ? "sim" : "nao");
+        fprintf(metrics, "Nivel de registo: %s\n", log_level_names[log_level]);
+        fprintf(metrics, "Mensagens de registo descartadas: %lld\n", log_dropped);
+#ifdef SEARCH_PROFILE
+        fprintf(metrics, "Perfil da busca: sim\n");
+#else
+        fprintf(metrics, "Perfil da busca: nao (compilar com -DSEARCH_PROFILE)\n");
+#endif
+        if (deterministic_mode)
+        {
+            fprintf(metrics, "Rondas deterministicas: %lld\n", det_rounds);
+            fprintf(metrics, "Tarefas deterministicas: %lld\n", det_tasks);
+            fprintf(metrics, "Tempo das threads parado nas barreiras: %.4f segundos (%.2f%%)\n", det_barrier_time,
+                    wall_elapsed > 0 ? 100.0 * det_barrier_time / (wall_elapsed * num_workers) : 0.0);
+        }
+        if (deterministic_compare)
+        {
+            fprintf(metrics, "Busca livre (referencia): makespan=%d, nos=%lld, tempo=%.4f segundos\n", free_makespan, free_nodes, free_wall);
+            fprintf(metrics, "Custo do modo deterministico: tempo x%.2f, nos x%.2f\n",
+                    free_wall > 0 ? wall_elapsed / free_wall : 1.0,
+                    free_nodes > 0 ? (double)nodes_explored / free_nodes : 1.0);
+        }
+        if (strategy_type != STRATEGY_DFS)
+        {
+            fprintf(metrics, "Pool de nos (capacidade): %d\n", node_pool.capacity);
+            fprintf(metrics, "Pool de nos (pico): %d\n", node_pool.peak);
+            fprintf(metrics, "Recursos a DFS (pool cheio): %lld\n", pool_fallbacks);
+        }
+        if (strategy_type == STRATEGY_HYBRID)
+        {
+            if (phase_switch_time >= 0)
+                fprintf(metrics, "Mudanca para best-first: t=%.4f segundos, nos=%lld\n", phase_switch_time, phase_switch_nodes);
+            else
+                fprintf(metrics, "Mudanca para best-first: nao ocorreu\n");
+        }
+        if (resume_filename)
+        {
+            fprintf(metrics, "Retomado de: %s\n", resume_filename);
+            fprintf(metrics, "Tempo acumulado com execucoes anteriores (Wall): %.4f segundos\n",
+                    checkpoint_prior_wall + wall_elapsed);
+        }
+        if (checkpoint_filename)
+        {
+            fprintf(metrics, "Checkpoints escritos: %lld\n", checkpoints_written);
+            fprintf(metrics, "Pausa maxima por checkpoint: %.3f ms\n", checkpoint_max_pause * 1000.0);
+        }
+        fprintf(metrics, "Tabela de transposicao (entradas): %lld\n", tt_num_entries());
+        if (tt_num_entries() > 0)
+        {
+            fprintf(metrics, "Tabela de transposicao (consultas): %lld\n", tt_probes);
+            fprintf(metrics, "Tabela de transposicao (podas): %lld\n", tt_hits);
+            fprintf(metrics, "Tabela de transposicao (taxa de acerto): %.2f%%\n",
+                    tt_probes > 0 ? 100.0 * tt_hits / tt_probes : 0.0);
+            fprintf(metrics, "Tabela de transposicao (escritas): %lld\n", tt_stores);
+            fprintf(metrics, "Tabela de transposicao (taxa de substituicao): %.2f%%\n",
+                    tt_stores > 0 ? 100.0 * tt_replacements / tt_stores : 0.0);
+        }
+#ifdef USE_MPI
+        fprintf(metrics, "Processos MPI: %d\n", mpi_size);
+        for (int r = 0; r < mpi_size; r++)
+        {
+            fprintf(metrics, "Rank %d: nos=%lld, tempo ocioso=%.4f segundos\n", r, mpi_rank_nodes[r], mpi_rank_idle[r]);
+        }
+        fprintf(metrics, "Subproblemas enviados entre ranks: %lld\n", mpi_subproblems_sent);
+        fprintf(metrics, "Incumbentes difundidos: %lld\n", mpi_broadcasts);
+#endif
+#if defined(USE_MPI) || defined(_OPENMP)
+#ifdef USE_MPI
+        fprintf(metrics, "Algoritmo: Branch and Bound Paralelo (MPI e Roubo de Trabalho)\n");
+#else
+        fprintf(metrics, "Algoritmo: Branch and Bound Paralelo (Roubo de Trabalho)\n");
+#endif
 #ifdef _OPENMP
-        fprintf(metrics, "Algoritmo: Branch and Bound Paralelo (Limite Fixo)\n");
         fprintf(metrics, "Threads utilizadas: %d\n", omp_get_max_threads());
+#else
+        fprintf(metrics, "Threads utilizadas: 1\n");
+#endif
         fprintf(metrics, "Speedup: %.2fx\n", elapsed > 0 ? elapsed / wall_elapsed : 1.0);
+        fprintf(metrics, "Roubos de trabalho: %lld\n", steals_performed);
+        fprintf(metrics, "Subproblemas doados: %lld\n", subproblems_donated);
 #else
         fprintf(metrics, "Algoritmo: Branch and Bound Sequencial\n");
 #endif
@@ -603,33 +5392,62 @@ int main(int argc, char **argv)
     {
         printf("Erro ao criar Ficheiro de metricas: %s\n", metrics_filename);
     }
+#ifdef SEARCH_PROFILE
+    write_search_profile(metrics_filename);
+#endif
 
     // Exibe os resultados finais no terminal
     printf("\n=== RESULTADOS ===\n");
     printf("Melhor makespan: %d\n", best_makespan);
     printf("Tempo de execucao: %.4f segundos\n", wall_elapsed);
-    printf("Nos explorados: %lld / %d (%.1f%%)\n",
-           nodes_explored, MAX_TOTAL_NODES,
-           (double)nodes_explored / MAX_TOTAL_NODES * 100.0);
+    printf("Nos explorados: %lld / %lld (%.1f%%)\n",
+           nodes_explored, node_limit,
+           (double)nodes_explored / node_limit * 100.0);
+    printf("Paragem: %s\n", stop_names[search_stop]);
+    if (heuristic_baseline)
+        printf("Nos poupados pela heuristica inicial: %lld de %lld\n", baseline_nodes - nodes_explored, baseline_nodes);
+    printf("Lower bound global: %d (gap %.2f%%)\n", global_lower_bound,
+           100.0 * (best_makespan - global_lower_bound) / best_makespan);
 #ifdef _OPENMP
     printf("Threads: %d, Speedup: %.2fx\n", omp_get_max_threads(),
            elapsed > 0 ? elapsed / wall_elapsed : 1.0);
 #endif
 
-    printf("\nEscalonamento otimo:\n");
+    if (global_lower_bound >= best_makespan)
+        printf("\nEscalonamento otimo:\n");
+    else
+        printf("\nMelhor escalonamento encontrado (otimo nao provado):\n");
     for (int j = 0; j < num_jobs; j++)
     {
         printf("Job %d: ", j);
         for (int op = 0; op < num_machines; op++)
         {
-            printf("Op%d(M%d,t=%d->%d) ", op, job_machine[j][op],
-                   best_schedule[j][op], best_schedule[j][op] + job_duration[j][op]);
+            int k = j * num_machines + op;
+            printf("Op%d(M%d,t=%d->%d) ", op, job_machine[k],
+                   best_schedule[k], best_schedule[k] + job_duration[k]);
         }
         printf("\n");
     }
 
     printf("\nResultados guardados em: %s\n", output_filename);
     printf("Metricas guardadas em: %s\n", metrics_filename);
+#ifdef SEARCH_PROFILE
+    char profile_name[1024];
+    profile_filename(profile_name, sizeof(profile_name), metrics_filename, "_perfil_*.csv");
+    printf("Perfil da busca guardado em: %s\n", profile_name);
+#endif
 
+    tt_free();
+    free(resume_nodes);
+    free(resume_jobs);
+    free(checkpoint_image.data);
+    free(incumbent_timeline);
+    free(index_schedule);
+    free(search_profile);
+#ifdef USE_MPI
+    free(mpi_rank_nodes);
+    free(mpi_rank_idle);
+    MPI_Finalize();
+#endif
     return 0;
 }
\ No newline at end of file
@@ -2,35 +2,191 @@
 #include <stdlib.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
+#include <stdint.h>
 
-#define MAX_JOBS 105     // Número máximo de jobs
-#define MAX_MACHINES 105 // Número máximo de máquinas
+#define CACHE_LINE 64 // Alinhamento dos vetores reservados (evita partilha de linhas entre threads)
 
-// Variáveis globais para armazenar dados do problema
+// Durações guardadas em 16 bits (até 65535); compile com -DWIDE_DURATIONS para 32 bits
+#ifdef WIDE_DURATIONS
+typedef int32_t duration_t;
+#define DURATION_MAX INT32_MAX
+#else
+typedef uint16_t duration_t;
+#define DURATION_MAX UINT16_MAX
+#endif
+
+#define CARLIER_MAX_NODES 10000        // Nós por subproblema de uma máquina; acima fica a melhor sequência
+#define REOPTIMIZATION_ITERATIONS 4    // Iterações de melhoria sobre as máquinas já sequenciadas após cada gargalo
+#define IMPROVEMENT_ITERATIONS 10      // Iterações da fase 2 por máquina
+
+// Variáveis globais para armazenar dados do problema. Os vetores são reservados em
+// read_input com o tamanho do cabeçalho da instância (estrutura de vetores, um campo por
+// vetor); as operações são indexadas pelo id j * num_machines + op.
 int num_jobs, num_machines;
-int job_machine[MAX_JOBS][MAX_MACHINES];  // Máquina de cada operação de cada job
-int job_duration[MAX_JOBS][MAX_MACHINES]; // Duração de cada operação de cada job
+uint16_t *operation_machine;    // Máquina de cada operação
+duration_t *operation_duration; // Duração de cada operação
+size_t allocated_bytes = 0;     // Memória reservada pelo programa
+
+int best_makespan;  // Melhor makespan encontrado
+int *best_schedule; // Melhor escalonamento encontrado (início de cada operação)
+
+int *job_completion_time;     // Tempo de conclusão de cada job
+int *machine_completion_time; // Tempo de conclusão de cada máquina
+
+// Grafo disjuntivo: os arcos conjuntivos ligam as operações seguidas de um job e os
+// disjuntivos as operações seguidas de cada máquina já sequenciada. Os arcos dos jobs e
+// as durações são fixos e partilhados; o resto do grafo está num GraphWorkspace.
+int *job_pred;           // Operação anterior no mesmo job (-1 se nenhuma)
+int *job_succ;           // Operação seguinte no mesmo job (-1 se nenhuma)
+int max_machine_ops = 0; // Maior número de operações numa máquina
 
-int best_makespan;                         // Melhor makespan encontrado
-int best_schedule[MAX_JOBS][MAX_MACHINES]; // Melhor escalonamento encontrado
+// Índice máquina -> operações (CSR), construído ao ler a instância: as operações da
+// máquina m, por ordem de job, são machine_ops[machine_first[m]] até
+// machine_ops[machine_first[m + 1] - 1]. As linhas de GraphWorkspace.sequence usam os
+// mesmos inícios.
+int *machine_first;
+int *machine_ops;
+int *machine_op_count; // Número de operações por máquina
+int *machine_workload; // Soma das durações das operações de cada máquina
 
-// Estrutura para representar uma operação
+// Subproblema de uma máquina (1|r_j,q_j|Cmax) resolvido pelo algoritmo de Carlier: as
+// operações da máquina com libertação (cabeça), duração e cauda
 typedef struct
 {
-    int job;
-    int operation;
-    int start_time;
-    int end_time;
-    int machine;
-    int duration;
-} Operation;
+    int count;
+    int *release;
+    int *duration;
+    int *tail;
+    int *operations; // Id de cada operação no grafo
+    int *done;       // Auxiliares do Schrage e da relaxação preemptiva
+    int *remaining;
+    int *order;      // Sequência do Schrage no nó atual
+    int *start;
+    int *best_order; // Melhor sequência encontrada
+    int best_value;
+    int lower_bound; // Relaxação preemptiva na raiz
+    long long nodes;
+    int truncated;   // A pesquisa parou em CARLIER_MAX_NODES nós
+} OneMachineProblem;
+
+// Estado mutável do grafo (arcos das máquinas, cabeças, caudas e ordem topológica) e os
+// auxiliares para o alterar, reservados uma vez com o tamanho da instância
+typedef struct
+{
+    int *head;              // Caminho mais longo da origem até ao início da operação
+    int *tail;              // Caminho mais longo do fim da operação até ao fim
+    int *machine_pred;      // Operação anterior na mesma máquina (-1 se nenhuma)
+    int *machine_succ;      // Operação seguinte na mesma máquina (-1 se nenhuma)
+    int *machine_sequenced; // 1 se os arcos da máquina estão no grafo
+    int *sequence;          // Sequência de cada máquina (ids), a partir de machine_first[m]
+    int *topo_order;        // Operações por ordem topológica (mantida entre mudanças)
+    int *topo_position;     // Posição de cada operação em topo_order
+    int makespan;           // Caminho mais longo do grafo
+
+    // Auxiliares da ordenação topológica, da reordenação e da propagação
+    int *indegree;
+    int *visit_mark; // visit_stamp se a operação foi visitada na reordenação atual
+    int visit_stamp;
+    int *dirty_mark; // dirty_stamp se a operação tem de ser recalculada
+    int dirty_stamp;
+    int *forward_region;  // Descendentes do destino do arco a reordenar (posições)
+    int *backward_region; // Ascendentes da origem do arco a reordenar (posições)
+    int *region_positions;
+    int *saved_sequence;       // Sequência anterior da máquina em reotimização
+    OneMachineProblem problem; // Subproblema de Carlier com espaço para max_machine_ops operações
 
-Operation machine_schedule[MAX_MACHINES][MAX_JOBS * MAX_MACHINES]; // Escalonamento por máquina
-int machine_op_count[MAX_MACHINES];                                // Número de operações por máquina
+    long long carlier_nodes;      // Nós de Carlier nos subproblemas resolvidos neste grafo
+    long long carlier_truncated;  // Subproblemas que atingiram CARLIER_MAX_NODES
+    long long cycles_repaired;    // Sequências que criavam um ciclo no grafo
+    long long updates;            // Atualizações incrementais do grafo
+    long long updated_operations; // Operações recalculadas nessas atualizações
+    long long reorders;           // Arcos novos que obrigaram a reordenar topo_order
+} GraphWorkspace;
+
+GraphWorkspace graph; // Grafo com as sequências aceites
+
+long long reoptimizations_accepted = 0;
+int initial_lower_bound = 0; // Maior subproblema no grafo só com arcos conjuntivos
+
+// Reotimizações avaliadas sobre uma cópia do grafo aceite, para que todas as máquinas
+// de uma iteração vejam o mesmo grafo (ver improve_best_machine)
+GraphWorkspace trial;
+int *candidate_makespan = NULL; // Makespan com a nova sequência de cada máquina
+int *candidate_changed = NULL;  // A nova sequência é diferente da aceite
+int *candidate_sequences = NULL; // Nova sequência de cada máquina, na linha machine_first[m]
+long long reoptimization_evaluations = 0;
+long long sideways_moves = 0; // Sequências trocadas sem mudar o makespan
+int last_sideways_machine = -1;
+
+// Reserva memória alinhada à linha de cache ou termina o programa com uma mensagem de
+// erro; o tamanho é arredondado a um múltiplo de CACHE_LINE, como exige aligned_alloc
+void *checked_malloc(size_t size, const char *what)
+{
+    size = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    if (size == 0)
+        size = CACHE_LINE;
+    void *ptr = aligned_alloc(CACHE_LINE, size);
+    allocated_bytes += size;
+    if (!ptr)
+    {
+        printf("ERRO: Memoria insuficiente para %s\n", what);
+        exit(1);
+    }
+    return ptr;
+}
 
-int job_completion_time[MAX_JOBS];                // Tempo de conclusão de cada job
-int machine_completion_time[MAX_MACHINES];        // Tempo de conclusão de cada máquina
-int operation_start_time[MAX_JOBS][MAX_MACHINES]; // Tempo de início de cada operação
+// Constrói o índice máquina -> operações e as cargas das máquinas: uma contagem, os
+// inícios por soma acumulada e uma passagem pelas operações, que ficam por ordem de job
+void build_machine_index()
+{
+    int num_ops = num_jobs * num_machines;
+    int *filled = (int *)checked_malloc(sizeof(int) * num_machines, "o indice das maquinas");
+    for (int m = 0; m < num_machines; m++)
+    {
+        machine_op_count[m] = 0;
+        machine_workload[m] = 0;
+        filled[m] = 0;
+    }
+    for (int id = 0; id < num_ops; id++)
+    {
+        machine_op_count[operation_machine[id]]++;
+        machine_workload[operation_machine[id]] += operation_duration[id];
+    }
+
+    machine_first[0] = 0;
+    max_machine_ops = 0;
+    for (int m = 0; m < num_machines; m++)
+    {
+        machine_first[m + 1] = machine_first[m] + machine_op_count[m];
+        if (machine_op_count[m] > max_machine_ops)
+            max_machine_ops = machine_op_count[m];
+    }
+
+    for (int id = 0; id < num_ops; id++)
+    {
+        int m = operation_machine[id];
+        machine_ops[machine_first[m] + filled[m]++] = id;
+    }
+    free(filled);
+}
+
+// Reserva os vetores da instância com o tamanho lido do cabeçalho
+void allocate_instance()
+{
+    int num_ops = num_jobs * num_machines;
+    operation_machine = (uint16_t *)checked_malloc(sizeof(uint16_t) * num_ops, "as operacoes");
+    operation_duration = (duration_t *)checked_malloc(sizeof(duration_t) * num_ops, "as operacoes");
+    best_schedule = (int *)checked_malloc(sizeof(int) * num_ops, "o escalonamento");
+    job_pred = (int *)checked_malloc(sizeof(int) * num_ops, "os arcos dos jobs");
+    job_succ = (int *)checked_malloc(sizeof(int) * num_ops, "os arcos dos jobs");
+    job_completion_time = (int *)checked_malloc(sizeof(int) * num_jobs, "os tempos de conclusao");
+    machine_completion_time = (int *)checked_malloc(sizeof(int) * num_machines, "os tempos de conclusao");
+    machine_first = (int *)checked_malloc(sizeof(int) * (num_machines + 1), "o indice das maquinas");
+    machine_ops = (int *)checked_malloc(sizeof(int) * num_ops, "o indice das maquinas");
+    machine_op_count = (int *)checked_malloc(sizeof(int) * num_machines, "o indice das maquinas");
+    machine_workload = (int *)checked_malloc(sizeof(int) * num_machines, "o indice das maquinas");
+}
 
 // Função para ler o ficheiro de input
 void read_input(const char *input_filename)
@@ -42,18 +198,51 @@ void read_input(const char *input_filename)
         exit(1);
     }
 
-    fscanf(input, "%d %d", &num_jobs, &num_machines);
+    if (fscanf(input, "%d %d", &num_jobs, &num_machines) != 2 || num_jobs <= 0 || num_machines <= 0 ||
+        num_machines > UINT16_MAX + 1 || (long long)num_jobs * num_machines > INT_MAX)
+    {
+        printf("ERRO: Cabecalho invalido no ficheiro %s\n", input_filename);
+        exit(1);
+    }
     printf("Problema: %d jobs, %d machines\n", num_jobs, num_machines);
+    allocate_instance();
 
-    // Leitura das operações de cada job
+    // Leitura das operações de cada job; a soma das durações limita o makespan e tem de
+    // caber num int
+    long long total_duration = 0;
     for (int j = 0; j < num_jobs; j++)
     {
         for (int op = 0; op < num_machines; op++)
         {
-            fscanf(input, "%d %d", &job_machine[j][op], &job_duration[j][op]);
+            int id = j * num_machines + op;
+            int machine, duration;
+            if (fscanf(input, "%d %d", &machine, &duration) != 2)
+            {
+                printf("ERRO: Ficheiro %s incompleto no job %d\n", input_filename, j);
+                exit(1);
+            }
+            if (machine < 0 || machine >= num_machines)
+            {
+                printf("ERRO: Maquina %d invalida na operacao %d do job %d\n", machine, op, j);
+                exit(1);
+            }
+            if (duration < 0 || duration > DURATION_MAX)
+            {
+                printf("ERRO: Duracao %d invalida na operacao %d do job %d (maximo %d)\n", duration, op, j, (int)DURATION_MAX);
+                exit(1);
+            }
+            operation_machine[id] = (uint16_t)machine;
+            operation_duration[id] = (duration_t)duration;
+            total_duration += duration;
         }
     }
     fclose(input);
+    if (total_duration > INT_MAX)
+    {
+        printf("ERRO: Soma das duracoes demasiado grande\n");
+        exit(1);
+    }
+    build_machine_index();
 
     // Impressão dos dados lidos
     printf("\nDados do problema:\n");
@@ -62,232 +251,831 @@ void read_input(const char *input_filename)
         printf("Job %d: ", j);
         for (int op = 0; op < num_machines; op++)
         {
-            printf("(M%d,%d) ", job_machine[j][op], job_duration[j][op]);
+            int id = j * num_machines + op;
+            printf("(M%d,%d) ", operation_machine[id], operation_duration[id]);
         }
         printf("\n");
     }
     printf("\n");
 }
 
-// Inicializa as estruturas de dados para uma nova solução
+// Inicializa as estruturas de dados para uma nova solução: nenhuma máquina sequenciada,
+// o grafo disjuntivo só tem os arcos conjuntivos (ordem das operações de cada job)
 void initialize_solution()
 {
+    for (int m = 0; m < num_machines; m++)
+    {
+        machine_completion_time[m] = 0;
+    }
+
     for (int j = 0; j < num_jobs; j++)
     {
         job_completion_time[j] = 0;
         for (int op = 0; op < num_machines; op++)
         {
-            operation_start_time[j][op] = 0;
-            best_schedule[j][op] = 0;
+            int id = j * num_machines + op;
+            best_schedule[id] = 0;
+            job_pred[id] = (op > 0) ? id - 1 : -1;
+            job_succ[id] = (op + 1 < num_machines) ? id + 1 : -1;
         }
     }
 
+    best_makespan = INT_MAX;
+}
+
+// Reserva os vetores de um workspace para a instância lida, com o grafo só com os arcos
+// dos jobs e as sequências das máquinas por ordem de job
+void workspace_init(GraphWorkspace *g)
+{
+    int num_ops = num_jobs * num_machines;
+    g->head = (int *)checked_malloc(sizeof(int) * num_ops, "as cabecas do grafo");
+    g->tail = (int *)checked_malloc(sizeof(int) * num_ops, "as caudas do grafo");
+    g->machine_pred = (int *)checked_malloc(sizeof(int) * num_ops, "os arcos das maquinas");
+    g->machine_succ = (int *)checked_malloc(sizeof(int) * num_ops, "os arcos das maquinas");
+    g->machine_sequenced = (int *)checked_malloc(sizeof(int) * num_machines, "o estado das maquinas");
+    g->sequence = (int *)checked_malloc(sizeof(int) * num_ops, "as sequencias das maquinas");
+    g->topo_order = (int *)checked_malloc(sizeof(int) * num_ops, "a ordem topologica");
+    g->topo_position = (int *)checked_malloc(sizeof(int) * num_ops, "a ordem topologica");
+    g->indegree = (int *)checked_malloc(sizeof(int) * num_ops, "a ordem topologica");
+    g->visit_mark = (int *)checked_malloc(sizeof(int) * num_ops, "a reordenacao topologica");
+    g->dirty_mark = (int *)checked_malloc(sizeof(int) * num_ops, "a propagacao do grafo");
+    g->forward_region = (int *)checked_malloc(sizeof(int) * num_ops, "a reordenacao topologica");
+    g->backward_region = (int *)checked_malloc(sizeof(int) * num_ops, "a reordenacao topologica");
+    g->region_positions = (int *)checked_malloc(sizeof(int) * num_ops, "a reordenacao topologica");
+    g->saved_sequence = (int *)checked_malloc(sizeof(int) * max_machine_ops, "as sequencias das maquinas");
+
+    int n = max_machine_ops;
+    int *buffer = (int *)checked_malloc(sizeof(int) * n * 9, "o subproblema de uma maquina");
+    g->problem.release = buffer;
+    g->problem.duration = buffer + n;
+    g->problem.tail = buffer + 2 * n;
+    g->problem.done = buffer + 3 * n;
+    g->problem.remaining = buffer + 4 * n;
+    g->problem.best_order = buffer + 5 * n;
+    g->problem.operations = buffer + 6 * n;
+    g->problem.order = buffer + 7 * n;
+    g->problem.start = buffer + 8 * n;
+
+    for (int id = 0; id < num_ops; id++)
+    {
+        g->head[id] = 0;
+        g->tail[id] = 0;
+        g->machine_pred[id] = -1;
+        g->machine_succ[id] = -1;
+        g->visit_mark[id] = 0;
+        g->dirty_mark[id] = 0;
+    }
     for (int m = 0; m < num_machines; m++)
     {
-        machine_completion_time[m] = 0;
-        machine_op_count[m] = 0;
+        g->machine_sequenced[m] = 0;
     }
+    memcpy(g->sequence, machine_ops, sizeof(int) * num_ops);
+    g->makespan = 0;
+    g->visit_stamp = 0;
+    g->dirty_stamp = 0;
+    g->carlier_nodes = 0;
+    g->carlier_truncated = 0;
+    g->cycles_repaired = 0;
+    g->updates = 0;
+    g->updated_operations = 0;
+    g->reorders = 0;
+}
 
-    best_makespan = INT_MAX;
+void workspace_free(GraphWorkspace *g)
+{
+    free(g->head);
+    free(g->tail);
+    free(g->machine_pred);
+    free(g->machine_succ);
+    free(g->machine_sequenced);
+    free(g->sequence);
+    free(g->topo_order);
+    free(g->topo_position);
+    free(g->indegree);
+    free(g->visit_mark);
+    free(g->dirty_mark);
+    free(g->forward_region);
+    free(g->backward_region);
+    free(g->region_positions);
+    free(g->saved_sequence);
+    free(g->problem.release);
 }
 
-// Calcula os tempos mais cedo possíveis de início das operações
-void calculate_earliest_start_times()
+// Cabeça de uma operação a partir das dos seus predecessores (job e máquina)
+static inline int operation_head_from_preds(const GraphWorkspace *g, int id)
 {
+    int head = 0;
+    int prev = job_pred[id];
+    if (prev >= 0)
+        head = g->head[prev] + operation_duration[prev];
+    prev = g->machine_pred[id];
+    if (prev >= 0 && g->head[prev] + operation_duration[prev] > head)
+        head = g->head[prev] + operation_duration[prev];
+    return head;
+}
+
+// Cauda de uma operação a partir das dos seus sucessores (job e máquina)
+static inline int operation_tail_from_succs(const GraphWorkspace *g, int id)
+{
+    int tail = 0;
+    int next = job_succ[id];
+    if (next >= 0)
+        tail = operation_duration[next] + g->tail[next];
+    next = g->machine_succ[id];
+    if (next >= 0 && operation_duration[next] + g->tail[next] > tail)
+        tail = operation_duration[next] + g->tail[next];
+    return tail;
+}
+
+// O caminho mais longo termina na última operação de um job, porque cada operação acaba
+// antes de a seguinte do mesmo job começar
+void update_graph_makespan(GraphWorkspace *g)
+{
+    g->makespan = 0;
     for (int j = 0; j < num_jobs; j++)
     {
-        job_completion_time[j] = 0;
-        for (int op = 0; op < num_machines; op++)
-        {
-            operation_start_time[j][op] = 0;
-        }
+        int last = j * num_machines + num_machines - 1;
+        if (g->head[last] + operation_duration[last] > g->makespan)
+            g->makespan = g->head[last] + operation_duration[last];
     }
+}
 
-    for (int m = 0; m < num_machines; m++)
+// Calcula as cabeças e as caudas de todas as operações no grafo com os arcos conjuntivos
+// e os das máquinas sequenciadas, pela ordem topológica de Kahn. Devolve o makespan do
+// grafo, ou -1 se houver um ciclo.
+int compute_heads_and_tails(GraphWorkspace *g)
+{
+    int num_ops = num_jobs * num_machines;
+    int count = 0;
+
+    for (int id = 0; id < num_ops; id++)
     {
-        machine_completion_time[m] = 0;
+        g->indegree[id] = (job_pred[id] >= 0) + (g->machine_pred[id] >= 0);
+        if (g->indegree[id] == 0)
+            g->topo_order[count++] = id;
     }
 
-    // Para cada job, calcula o início de cada operação sequencialmente
-    for (int j = 0; j < num_jobs; j++)
+    // A fila é a própria ordem topológica: os nós entram no fim quando ficam sem predecessores
+    for (int k = 0; k < count; k++)
     {
-        int current_time = 0;
-        for (int op = 0; op < num_machines; op++)
+        int id = g->topo_order[k];
+        if (job_succ[id] >= 0 && --g->indegree[job_succ[id]] == 0)
+            g->topo_order[count++] = job_succ[id];
+        if (g->machine_succ[id] >= 0 && --g->indegree[g->machine_succ[id]] == 0)
+            g->topo_order[count++] = g->machine_succ[id];
+    }
+    if (count < num_ops)
+        return -1;
+
+    for (int k = 0; k < num_ops; k++)
+    {
+        int id = g->topo_order[k];
+        g->head[id] = operation_head_from_preds(g, id);
+        g->topo_position[id] = k;
+    }
+    for (int k = num_ops - 1; k >= 0; k--)
+    {
+        int id = g->topo_order[k];
+        g->tail[id] = operation_tail_from_succs(g, id);
+    }
+    update_graph_makespan(g);
+    return g->makespan;
+}
+
+int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Mantém topo_order válida ao acrescentar o arco from -> to com from depois de to
+// (Pearce-Kelly): só as operações entre as duas posições podem ter de mudar. Os
+// descendentes de to nessa janela passam para depois dos ascendentes de from, nas
+// mesmas posições. Devolve 0 se o arco fecha um ciclo (from é descendente de to).
+int reorder_for_arc(GraphWorkspace *g, int from, int to)
+{
+    int lower = g->topo_position[to];
+    int upper = g->topo_position[from];
+    int forward_count = 0, backward_count = 0;
+
+    // As regiões guardam posições, para se ordenarem sem olhar para o workspace
+    g->visit_stamp++;
+    g->visit_mark[to] = g->visit_stamp;
+    g->forward_region[forward_count++] = lower;
+    for (int k = 0; k < forward_count; k++)
+    {
+        int id = g->topo_order[g->forward_region[k]];
+        int next[2] = {job_succ[id], g->machine_succ[id]};
+        for (int a = 0; a < 2; a++)
         {
-            operation_start_time[j][op] = current_time;
-            current_time += job_duration[j][op];
-            job_completion_time[j] = current_time;
+            if (next[a] < 0 || g->visit_mark[next[a]] == g->visit_stamp || g->topo_position[next[a]] > upper)
+                continue;
+            if (next[a] == from)
+                return 0;
+            g->visit_mark[next[a]] = g->visit_stamp;
+            g->forward_region[forward_count++] = g->topo_position[next[a]];
         }
     }
+
+    g->visit_mark[from] = g->visit_stamp;
+    g->backward_region[backward_count++] = upper;
+    for (int k = 0; k < backward_count; k++)
+    {
+        int id = g->topo_order[g->backward_region[k]];
+        int prev[2] = {job_pred[id], g->machine_pred[id]};
+        for (int a = 0; a < 2; a++)
+        {
+            if (prev[a] < 0 || g->visit_mark[prev[a]] == g->visit_stamp || g->topo_position[prev[a]] < lower)
+                continue;
+            g->visit_mark[prev[a]] = g->visit_stamp;
+            g->backward_region[backward_count++] = g->topo_position[prev[a]];
+        }
+    }
+
+    qsort(g->forward_region, forward_count, sizeof(int), compare_int);
+    qsort(g->backward_region, backward_count, sizeof(int), compare_int);
+
+    // Junta as posições ocupadas pelas duas regiões, por ordem, e passa as regiões a ids
+    int b = 0, f = 0;
+    while (b < backward_count || f < forward_count)
+    {
+        int take_backward = f == forward_count ||
+                            (b < backward_count && g->backward_region[b] < g->forward_region[f]);
+        g->region_positions[b + f] = take_backward ? g->backward_region[b] : g->forward_region[f];
+        if (take_backward)
+            b++;
+        else
+            f++;
+    }
+    for (int k = 0; k < backward_count; k++)
+    {
+        g->backward_region[k] = g->topo_order[g->backward_region[k]];
+    }
+    for (int k = 0; k < forward_count; k++)
+    {
+        g->forward_region[k] = g->topo_order[g->forward_region[k]];
+    }
+
+    for (int k = 0; k < backward_count; k++)
+    {
+        g->topo_position[g->backward_region[k]] = g->region_positions[k];
+        g->topo_order[g->region_positions[k]] = g->backward_region[k];
+    }
+    for (int k = 0; k < forward_count; k++)
+    {
+        g->topo_position[g->forward_region[k]] = g->region_positions[backward_count + k];
+        g->topo_order[g->region_positions[backward_count + k]] = g->forward_region[k];
+    }
+    g->reorders++;
+    return 1;
 }
 
-// Calcula a carga de trabalho total de uma máquina
-int calculate_machine_workload(int machine)
+// Propaga as cabeças e as caudas depois de mudar os arcos da máquina: as suas operações
+// são as únicas com outros predecessores e sucessores, e uma operação só é recalculada
+// se for uma delas ou se a cabeça (cauda) de um predecessor (sucessor) mudou. As
+// operações marcadas são visitadas pela ordem topológica, a partir da primeira (última)
+// marcada e até não haver marcas pendentes. Devolve o makespan do grafo.
+int propagate_machine_change(GraphWorkspace *g, int machine)
 {
-    int total_workload = 0;
-    for (int j = 0; j < num_jobs; j++)
+    const int *sequence = g->sequence + machine_first[machine];
+    int count = machine_op_count[machine];
+    int first = num_jobs * num_machines, last = -1;
+    g->updates++;
+
+    g->dirty_stamp++;
+    for (int k = 0; k < count; k++)
     {
-        for (int op = 0; op < num_machines; op++)
+        int id = sequence[k];
+        g->dirty_mark[id] = g->dirty_stamp;
+        if (g->topo_position[id] < first)
+            first = g->topo_position[id];
+        if (g->topo_position[id] > last)
+            last = g->topo_position[id];
+    }
+    int pending = count;
+    for (int k = first; pending > 0; k++)
+    {
+        int id = g->topo_order[k];
+        if (g->dirty_mark[id] != g->dirty_stamp)
+            continue;
+        pending--;
+        g->updated_operations++;
+        int head = operation_head_from_preds(g, id);
+        if (head == g->head[id])
+            continue;
+        g->head[id] = head;
+        if (job_succ[id] >= 0 && g->dirty_mark[job_succ[id]] != g->dirty_stamp)
         {
-            if (job_machine[j][op] == machine)
-            {
-                total_workload += job_duration[j][op];
-            }
+            g->dirty_mark[job_succ[id]] = g->dirty_stamp;
+            pending++;
         }
+        if (g->machine_succ[id] >= 0 && g->dirty_mark[g->machine_succ[id]] != g->dirty_stamp)
+        {
+            g->dirty_mark[g->machine_succ[id]] = g->dirty_stamp;
+            pending++;
+        }
+    }
+
+    g->dirty_stamp++;
+    for (int k = 0; k < count; k++)
+    {
+        g->dirty_mark[sequence[k]] = g->dirty_stamp;
     }
-    return total_workload;
+    pending = count;
+    for (int k = last; pending > 0; k--)
+    {
+        int id = g->topo_order[k];
+        if (g->dirty_mark[id] != g->dirty_stamp)
+            continue;
+        pending--;
+        g->updated_operations++;
+        int tail = operation_tail_from_succs(g, id);
+        if (tail == g->tail[id])
+            continue;
+        g->tail[id] = tail;
+        if (job_pred[id] >= 0 && g->dirty_mark[job_pred[id]] != g->dirty_stamp)
+        {
+            g->dirty_mark[job_pred[id]] = g->dirty_stamp;
+            pending++;
+        }
+        if (g->machine_pred[id] >= 0 && g->dirty_mark[g->machine_pred[id]] != g->dirty_stamp)
+        {
+            g->dirty_mark[g->machine_pred[id]] = g->dirty_stamp;
+            pending++;
+        }
+    }
+
+    update_graph_makespan(g);
+    return g->makespan;
+}
+
+// Uma operação é crítica se está num caminho mais longo do grafo (O(1) depois de uma atualização)
+int operation_is_critical(const GraphWorkspace *g, int id)
+{
+    return g->head[id] + operation_duration[id] + g->tail[id] == g->makespan;
 }
 
-// Escalona as operações de uma máquina
-void schedule_machine_operations(int machine)
+// Escalonamento de Schrage para 1|r_j,q_j|Cmax: sempre que a máquina fica livre, começa
+// a operação já libertada com maior cauda. Guarda a ordem e os inícios e devolve max(C_j + q_j).
+int schrage_schedule(OneMachineProblem *problem, int *order, int *start)
 {
-    Operation operations[MAX_JOBS * MAX_MACHINES];
-    int op_count = 0;
+    int n = problem->count;
+    int time = 0;
+    int value = 0;
+    for (int i = 0; i < n; i++)
+        problem->done[i] = 0;
 
-    // Seleciona operações que pertencem à máquina
-    for (int j = 0; j < num_jobs; j++)
+    for (int k = 0; k < n; k++)
     {
-        for (int op = 0; op < num_machines; op++)
+        int next = -1;
+        int min_release = INT_MAX;
+        for (int i = 0; i < n; i++)
         {
-            if (job_machine[j][op] == machine)
-            {
-                operations[op_count].job = j;
-                operations[op_count].operation = op;
-                operations[op_count].machine = machine;
-                operations[op_count].duration = job_duration[j][op];
-                operations[op_count].start_time = operation_start_time[j][op];
-                op_count++;
-            }
+            if (problem->done[i])
+                continue;
+            if (problem->release[i] < min_release)
+                min_release = problem->release[i];
+            if (problem->release[i] <= time &&
+                (next < 0 || problem->tail[i] > problem->tail[next] ||
+                 (problem->tail[i] == problem->tail[next] && problem->release[i] < problem->release[next])))
+                next = i;
         }
+        if (next < 0)
+        {
+            // Máquina parada até à próxima libertação
+            time = min_release;
+            k--;
+            continue;
+        }
+
+        problem->done[next] = 1;
+        order[k] = next;
+        start[k] = time;
+        time += problem->duration[next];
+        if (time + problem->tail[next] > value)
+            value = time + problem->tail[next];
     }
+    return value;
+}
 
-    // Ordena operações por tempo de início e duração
-    for (int i = 0; i < op_count - 1; i++)
+// Relaxação preemptiva (regra de Jackson): lower bound do subproblema de uma máquina
+int preemptive_bound(OneMachineProblem *problem)
+{
+    int n = problem->count;
+    int *remaining = problem->remaining;
+    int time = INT_MAX;
+    int value = 0;
+    int finished = 0;
+    for (int i = 0; i < n; i++)
     {
-        for (int k = i + 1; k < op_count; k++)
+        remaining[i] = problem->duration[i];
+        if (problem->release[i] < time)
+            time = problem->release[i];
+        if (remaining[i] == 0)
         {
-            int swap = 0;
+            finished++;
+            if (problem->release[i] + problem->tail[i] > value)
+                value = problem->release[i] + problem->tail[i];
+        }
+    }
 
-            if (operations[k].start_time < operations[i].start_time)
+    while (finished < n)
+    {
+        int next = -1;
+        int next_release = INT_MAX;
+        for (int i = 0; i < n; i++)
+        {
+            if (remaining[i] == 0)
+                continue;
+            if (problem->release[i] <= time)
             {
-                swap = 1;
+                if (next < 0 || problem->tail[i] > problem->tail[next])
+                    next = i;
             }
-            else if (operations[k].start_time == operations[i].start_time &&
-                     operations[k].duration < operations[i].duration)
+            else if (problem->release[i] < next_release)
             {
-                swap = 1;
+                next_release = problem->release[i];
             }
+        }
+        if (next < 0)
+        {
+            time = next_release;
+            continue;
+        }
 
-            if (swap)
-            {
-                Operation temp = operations[i];
-                operations[i] = operations[k];
-                operations[k] = temp;
-            }
+        // Corre até acabar ou até à próxima libertação, que pode ter maior cauda
+        int run = remaining[next];
+        if (next_release < time + run)
+            run = next_release - time;
+        time += run;
+        remaining[next] -= run;
+        if (remaining[next] == 0)
+        {
+            finished++;
+            if (time + problem->tail[next] > value)
+                value = time + problem->tail[next];
         }
     }
+    return value;
+}
 
-    int current_machine_time = 0;
-    machine_op_count[machine] = op_count;
+// Nó da pesquisa de Carlier: o Schrage dá uma solução; se não for ótima, o caminho
+// crítico tem uma operação c com cauda menor do que a última (b), e ramifica-se entre
+// pôr c antes ou depois do bloco J entre c e b, subindo a libertação ou a cauda de c.
+void carlier_branch(OneMachineProblem *problem)
+{
+    int n = problem->count;
+    if (problem->best_value <= problem->lower_bound)
+        return; // Já se atingiu o bound da raiz: a melhor sequência é ótima
+    if (problem->nodes >= CARLIER_MAX_NODES)
+    {
+        problem->truncated = 1;
+        return;
+    }
+    problem->nodes++;
+
+    // A ordem e os inícios só são usados antes de ramificar, por isso os níveis partilham-nos
+    int *order = problem->order;
+    int *start = problem->start;
+    int value = schrage_schedule(problem, order, start);
+    if (value < problem->best_value)
+    {
+        problem->best_value = value;
+        for (int k = 0; k < n; k++)
+            problem->best_order[k] = order[k];
+    }
+
+    // b: última operação do caminho crítico
+    int b = -1;
+    for (int k = 0; k < n; k++)
+    {
+        if (start[k] + problem->duration[order[k]] + problem->tail[order[k]] == value)
+            b = k;
+    }
+
+    // a: primeira operação com r_a + p(a..b) + q_b igual ao valor (início do caminho crítico)
+    int a = b;
+    int suffix = 0;
+    for (int k = 0; k <= b; k++)
+        suffix += problem->duration[order[k]];
+    for (int k = 0; k <= b; k++)
+    {
+        if (problem->release[order[k]] + suffix + problem->tail[order[b]] == value)
+        {
+            a = k;
+            break;
+        }
+        suffix -= problem->duration[order[k]];
+    }
+
+    // c: última operação do bloco com cauda menor do que a de b
+    int c = -1;
+    for (int k = b - 1; k >= a; k--)
+    {
+        if (problem->tail[order[k]] < problem->tail[order[b]])
+        {
+            c = k;
+            break;
+        }
+    }
+    if (c < 0)
+        return; // O Schrage é ótimo neste nó
 
-    // Agenda as operações na máquina
-    for (int i = 0; i < op_count; i++)
+    int min_release = INT_MAX;
+    int min_tail = INT_MAX;
+    int total = 0;
+    for (int k = c + 1; k <= b; k++)
     {
-        int earliest_start = operation_start_time[operations[i].job][operations[i].operation];
-        int actual_start = (current_machine_time > earliest_start) ? current_machine_time : earliest_start;
+        int i = order[k];
+        if (problem->release[i] < min_release)
+            min_release = problem->release[i];
+        if (problem->tail[i] < min_tail)
+            min_tail = problem->tail[i];
+        total += problem->duration[i];
+    }
 
-        operations[i].start_time = actual_start;
-        operations[i].end_time = actual_start + operations[i].duration;
+    int job = order[c];
+    int saved_release = problem->release[job];
+    int saved_tail = problem->tail[job];
 
-        machine_schedule[machine][i] = operations[i];
-        current_machine_time = operations[i].end_time;
+    // c depois de J
+    if (min_release + total > problem->release[job])
+        problem->release[job] = min_release + total;
+    if (preemptive_bound(problem) < problem->best_value)
+        carlier_branch(problem);
+    problem->release[job] = saved_release;
+
+    // c antes de J
+    if (min_tail + total > problem->tail[job])
+        problem->tail[job] = min_tail + total;
+    if (preemptive_bound(problem) < problem->best_value)
+        carlier_branch(problem);
+    problem->tail[job] = saved_tail;
+}
 
-        best_schedule[operations[i].job][operations[i].operation] = actual_start;
+// Resolve 1|r_j,q_j|Cmax da máquina com as cabeças e caudas de g (algoritmo de Carlier),
+// usando os vetores de problem, e guarda a sequência ótima das operações (ids) em
+// sequence. Devolve o valor do subproblema, max(C_j + q_j), que é o Lmax da máquina mais
+// uma constante; os nós da pesquisa e se atingiu CARLIER_MAX_NODES ficam em problem.
+int solve_machine_subproblem(const GraphWorkspace *g, int machine, OneMachineProblem *problem, int *sequence)
+{
+    const int *operations = machine_ops + machine_first[machine];
+    int n = machine_op_count[machine];
+    for (int i = 0; i < n; i++)
+    {
+        int id = operations[i];
+        problem->release[i] = g->head[id];
+        problem->duration[i] = operation_duration[id];
+        problem->tail[i] = g->tail[id];
+        problem->operations[i] = id;
     }
+    problem->count = n;
+    problem->nodes = 0;
+    problem->truncated = 0;
+    if (n == 0)
+        return 0;
+
+    problem->best_value = INT_MAX;
+    problem->lower_bound = preemptive_bound(problem);
+    carlier_branch(problem);
 
-    machine_completion_time[machine] = current_machine_time;
+    for (int k = 0; k < n; k++)
+    {
+        sequence[k] = problem->operations[problem->best_order[k]];
+    }
+    return problem->best_value;
 }
 
-// Atualiza o tempo de conclusão de cada job
-void update_job_completion_times()
+// Acrescenta ao grafo os arcos disjuntivos da sequência da máquina, um a um, mantendo
+// topo_order. Devolve 0 se algum arco fecha um ciclo; nesse caso a máquina fica
+// parcialmente ligada e tem de ser desligada.
+int link_machine_sequence(GraphWorkspace *g, int machine)
 {
-    for (int j = 0; j < num_jobs; j++)
+    const int *sequence = g->sequence + machine_first[machine];
+    g->machine_sequenced[machine] = 1;
+    for (int k = 1; k < machine_op_count[machine]; k++)
     {
-        int completion = 0;
-        for (int op = 0; op < num_machines; op++)
-        {
-            int start = best_schedule[j][op];
-            int end = start + job_duration[j][op];
-            if (end > completion)
-                completion = end;
-        }
-        job_completion_time[j] = completion;
+        int from = sequence[k - 1];
+        int to = sequence[k];
+        g->machine_succ[from] = to;
+        g->machine_pred[to] = from;
+        if (g->topo_position[from] > g->topo_position[to] && !reorder_for_arc(g, from, to))
+            return 0;
     }
+    return 1;
 }
 
-// Calcula o makespan atual
-int calculate_makespan()
+// Retira do grafo os arcos disjuntivos da máquina (topo_order continua válida)
+void unlink_machine_sequence(GraphWorkspace *g, int machine)
 {
-    int makespan = 0;
-    for (int j = 0; j < num_jobs; j++)
+    const int *sequence = g->sequence + machine_first[machine];
+    for (int k = 0; k < machine_op_count[machine]; k++)
     {
-        if (job_completion_time[j] > makespan)
-            makespan = job_completion_time[j];
+        g->machine_pred[sequence[k]] = -1;
+        g->machine_succ[sequence[k]] = -1;
     }
-    return makespan;
+    g->machine_sequenced[machine] = 0;
 }
 
-// Tenta melhorar o escalonamento de uma máquina
-int try_improve_machine_schedule(int machine)
+// Fixa a sequência calculada para a máquina (desligada, com cabeças e caudas já
+// propagadas) e propaga as mudanças. O Carlier pode trocar a ordem de operações ligadas
+// por um caminho que passa por outras máquinas e criar um ciclo; nesse caso (raro)
+// refaz-se o grafo sem a máquina por inteiro e usa-se a sua ordem topológica, que
+// respeita todos esses caminhos. Devolve o makespan do grafo.
+int fix_machine_sequence(GraphWorkspace *g, int machine)
 {
-    int saved_schedule[MAX_JOBS][MAX_MACHINES];
-    for (int j = 0; j < num_jobs; j++)
+    if (link_machine_sequence(g, machine))
+        return propagate_machine_change(g, machine);
+
+    unlink_machine_sequence(g, machine);
+    compute_heads_and_tails(g);
+    int *sequence = g->sequence + machine_first[machine];
+    for (int i = 1; i < machine_op_count[machine]; i++)
     {
-        for (int op = 0; op < num_machines; op++)
+        int entry = sequence[i];
+        int k = i;
+        while (k > 0 && g->topo_position[sequence[k - 1]] > g->topo_position[entry])
         {
-            saved_schedule[j][op] = best_schedule[j][op];
+            sequence[k] = sequence[k - 1];
+            k--;
         }
+        sequence[k] = entry;
     }
+    g->cycles_repaired++;
+    link_machine_sequence(g, machine);
+    return propagate_machine_change(g, machine);
+}
 
-    int saved_makespan = best_makespan;
+// Troca a sequência (ligada) da máquina por uma que se sabe não criar ciclos e devolve o
+// makespan do grafo
+int replace_machine_sequence(GraphWorkspace *g, int machine, const int *sequence)
+{
+    unlink_machine_sequence(g, machine);
+    memcpy(g->sequence + machine_first[machine], sequence, sizeof(int) * machine_op_count[machine]);
+    link_machine_sequence(g, machine);
+    return propagate_machine_change(g, machine);
+}
+
+// Reotimiza uma máquina já sequenciada: retira os seus arcos, resolve de novo o
+// subproblema com as cabeças e caudas das restantes e fixa a nova sequência, guardando a
+// anterior em saved_sequence. Devolve o makespan do grafo com a nova sequência.
+int reoptimize_machine(GraphWorkspace *g, int machine)
+{
+    int *sequence = g->sequence + machine_first[machine];
+    memcpy(g->saved_sequence, sequence, sizeof(int) * machine_op_count[machine]);
 
-    printf("Tentando melhorar escalonamento da maquina %d...\n", machine);
+    unlink_machine_sequence(g, machine);
+    propagate_machine_change(g, machine);
+    solve_machine_subproblem(g, machine, &g->problem, sequence);
+    g->carlier_nodes += g->problem.nodes;
+    g->carlier_truncated += g->problem.truncated;
+    return fix_machine_sequence(g, machine);
+}
 
-    calculate_earliest_start_times();
-    schedule_machine_operations(machine);
+// 1 se a sequência da máquina é diferente da guardada em saved_sequence
+int machine_sequence_changed(const GraphWorkspace *g, int machine)
+{
+    return memcmp(g->sequence + machine_first[machine], g->saved_sequence,
+                  sizeof(int) * machine_op_count[machine]) != 0;
+}
+
+// Copia as cabeças do grafo aceite para o escalonamento e atualiza os tempos de conclusão
+void update_schedule_from_graph()
+{
+    for (int j = 0; j < num_jobs; j++)
+    {
+        for (int op = 0; op < num_machines; op++)
+        {
+            int id = j * num_machines + op;
+            best_schedule[id] = graph.head[id];
+        }
+        int last = j * num_machines + num_machines - 1;
+        job_completion_time[j] = best_schedule[last] + operation_duration[last];
+    }
 
-    // Reescalona as outras máquinas
     for (int m = 0; m < num_machines; m++)
     {
-        if (m != machine)
+        machine_completion_time[m] = 0;
+        for (int k = 0; k < machine_op_count[m]; k++)
         {
-            schedule_machine_operations(m);
+            int id = graph.sequence[machine_first[m] + k];
+            int end_time = best_schedule[id] + operation_duration[id];
+            if (end_time > machine_completion_time[m])
+                machine_completion_time[m] = end_time;
         }
     }
+}
 
-    update_job_completion_times();
-    int new_makespan = calculate_makespan();
+// Calcula o makespan atual
+int calculate_makespan()
+{
+    int makespan = 0;
+    for (int j = 0; j < num_jobs; j++)
+    {
+        if (job_completion_time[j] > makespan)
+            makespan = job_completion_time[j];
+    }
+    return makespan;
+}
 
-    if (new_makespan < best_makespan)
+// Copia o grafo de from para g (os auxiliares e os contadores de g ficam)
+void workspace_copy(GraphWorkspace *g, const GraphWorkspace *from)
+{
+    size_t size = sizeof(int) * num_jobs * num_machines;
+    memcpy(g->head, from->head, size);
+    memcpy(g->tail, from->tail, size);
+    memcpy(g->machine_pred, from->machine_pred, size);
+    memcpy(g->machine_succ, from->machine_succ, size);
+    memcpy(g->sequence, from->sequence, size);
+    memcpy(g->topo_order, from->topo_order, size);
+    memcpy(g->topo_position, from->topo_position, size);
+    memcpy(g->machine_sequenced, from->machine_sequenced, sizeof(int) * num_machines);
+    g->makespan = from->makespan;
+}
+
+// Reotimiza a máquina sobre uma cópia do grafo aceite e guarda o resultado. Copiar o
+// grafo custa menos do que repor a sequência anterior, que obriga a propagar outra vez
+// as cabeças e caudas.
+void evaluate_reoptimization(int machine)
+{
+    workspace_copy(&trial, &graph);
+    candidate_makespan[machine] = reoptimize_machine(&trial, machine);
+    candidate_changed[machine] = machine_sequence_changed(&trial, machine);
+    memcpy(candidate_sequences + machine_first[machine], trial.sequence + machine_first[machine],
+           sizeof(int) * machine_op_count[machine]);
+}
+
+// Uma iteração de melhor melhoria: todas as máquinas de order são reotimizadas sobre o
+// mesmo grafo aceite e só a melhor é aplicada, a de menor makespan, com empates pela
+// máquina de menor índice. Se nenhuma melhora e allow_sideways, é aplicada uma sequência
+// diferente com o mesmo makespan, escolhida em rotação a partir da última aplicada
+// assim, para sair do patamar sem repetir sempre a mesma máquina. Devolve 1 se melhorou,
+// 2 se foi um movimento lateral e 0 se o grafo não mudou.
+int improve_best_machine(const int *order, int count, int *makespan, int allow_sideways, int print_attempts)
+{
+    int best = -1;
+    for (int i = 0; i < count; i++)
     {
-        best_makespan = new_makespan;
-        printf("Melhoria encontrada! Novo makespan: %d\n", best_makespan);
-        return 1;
+        int machine = order[i];
+        evaluate_reoptimization(machine);
+        if (print_attempts)
+            printf("Maquina %d reotimizada: makespan %d\n", machine, candidate_makespan[machine]);
+        if (candidate_makespan[machine] < *makespan &&
+            (best < 0 || candidate_makespan[machine] < candidate_makespan[best] ||
+             (candidate_makespan[machine] == candidate_makespan[best] && machine < best)))
+            best = machine;
     }
-    else
+    reoptimization_evaluations += count;
+
+    int result = 1;
+    if (best < 0 && allow_sideways)
     {
-        // Restaura o escalonamento anterior
-        for (int j = 0; j < num_jobs; j++)
+        for (int k = 1; k <= num_machines && best < 0; k++)
         {
-            for (int op = 0; op < num_machines; op++)
+            int machine = (last_sideways_machine + k) % num_machines;
+            for (int i = 0; i < count; i++)
             {
-                best_schedule[j][op] = saved_schedule[j][op];
+                if (order[i] == machine && candidate_changed[machine] && candidate_makespan[machine] == *makespan)
+                    best = machine;
             }
         }
-        best_makespan = saved_makespan;
-        printf("Nenhuma melhoria encontrada para maquina %d\n", machine);
+        if (best >= 0)
+        {
+            last_sideways_machine = best;
+            sideways_moves++;
+            result = 2;
+        }
+    }
+    if (best < 0)
         return 0;
+
+    *makespan = replace_machine_sequence(&graph, best, candidate_sequences + machine_first[best]);
+    if (result == 1)
+    {
+        reoptimizations_accepted++;
+        if (print_attempts)
+            printf("Melhoria encontrada na maquina %d! Novo makespan: %d\n", best, *makespan);
+    }
+    else if (print_attempts)
+    {
+        printf("Nenhuma melhoria; sequencia da maquina %d trocada com o mesmo makespan\n", best);
     }
+    return result;
+}
+
+// Reotimiza as máquinas sequenciadas até uma iteração sem melhorias ou max_iterations
+// iterações. Devolve o número de iterações feitas.
+int reoptimize_sequenced_machines(const int *sequenced_order, int sequenced_count, int *makespan, int max_iterations)
+{
+    int iterations = 0;
+    int improved = 1;
+    while (improved && iterations < max_iterations)
+    {
+        iterations++;
+        improved = improve_best_machine(sequenced_order, sequenced_count, makespan, 0, 0);
+    }
+    return iterations;
 }
 
 // Algoritmo principal Shifting Bottleneck
@@ -296,81 +1084,94 @@ void shifting_bottleneck_algorithm()
     printf("=== ALGORITMO SHIFTING BOTTLENECK SEQUENCIAL ===\n\n");
 
     initialize_solution();
+    workspace_init(&graph);
+    workspace_init(&trial);
+    candidate_makespan = (int *)checked_malloc(sizeof(int) * num_machines, "as candidatas");
+    candidate_changed = (int *)checked_malloc(sizeof(int) * num_machines, "as candidatas");
+    candidate_sequences = (int *)checked_malloc(sizeof(int) * num_jobs * num_machines, "as candidatas");
 
-    printf("Fase 1: Construindo escalonamento inicial...\n");
-    calculate_earliest_start_times();
-
-    int machine_order[MAX_MACHINES];
-    int machine_workload[MAX_MACHINES];
+    // Máquinas pela ordem em que foram sequenciadas e valor do subproblema de cada uma
+    int *machine_order = (int *)checked_malloc(sizeof(int) * num_machines, "a ordem das maquinas");
+    int *candidate_value = (int *)checked_malloc(sizeof(int) * num_machines, "os valores das maquinas");
 
-    for (int m = 0; m < num_machines; m++)
+    printf("Fase 1: Sequenciando as maquinas pelo gargalo (Carlier)...\n");
+    int makespan = compute_heads_and_tails(&graph);
+    for (int step = 0; step < num_machines; step++)
     {
-        machine_order[m] = m;
-        machine_workload[m] = calculate_machine_workload(m);
-    }
+        // Resolve o subproblema de cada máquina ainda por sequenciar
+        for (int m = 0; m < num_machines; m++)
+        {
+            if (graph.machine_sequenced[m])
+                continue;
+            candidate_value[m] = solve_machine_subproblem(&graph, m, &graph.problem, graph.sequence + machine_first[m]);
+            graph.carlier_nodes += graph.problem.nodes;
+            graph.carlier_truncated += graph.problem.truncated;
+        }
 
-    // Ordena máquinas por carga de trabalho (decrescente)
-    for (int i = 0; i < num_machines - 1; i++)
-    {
-        for (int j = i + 1; j < num_machines; j++)
+        // O gargalo é a máquina com maior Lmax; empates pela maior carga e menor índice
+        int bottleneck = -1;
+        for (int m = 0; m < num_machines; m++)
         {
-            if (machine_workload[machine_order[j]] > machine_workload[machine_order[i]])
-            {
-                int temp = machine_order[i];
-                machine_order[i] = machine_order[j];
-                machine_order[j] = temp;
-            }
+            if (graph.machine_sequenced[m])
+                continue;
+            if (bottleneck < 0 || candidate_value[m] > candidate_value[bottleneck] ||
+                (candidate_value[m] == candidate_value[bottleneck] && machine_workload[m] > machine_workload[bottleneck]))
+                bottleneck = m;
         }
-    }
+        if (step == 0)
+            initial_lower_bound = candidate_value[bottleneck];
 
-    printf("Ordem de escalonamento das maquinas por carga de trabalho:\n");
-    for (int i = 0; i < num_machines; i++)
-    {
-        printf("Maquina %d (carga: %d)\n", machine_order[i], machine_workload[machine_order[i]]);
-    }
+        // A sequência do gargalo já está em graph.sequence; as das outras máquinas
+        // são recalculadas no passo seguinte com as novas cabeças e caudas
+        makespan = fix_machine_sequence(&graph, bottleneck);
+        machine_order[step] = bottleneck;
+        printf("\nMaquina %d sequenciada (gargalo: %d, carga: %d), makespan parcial: %d\n",
+               bottleneck, candidate_value[bottleneck], machine_workload[bottleneck], makespan);
 
-    // Escalona cada máquina pela ordem definida
-    for (int i = 0; i < num_machines; i++)
-    {
-        int machine = machine_order[i];
-        printf("\nEscalonando maquina %d...\n", machine);
-        schedule_machine_operations(machine);
-        update_job_completion_times();
-        calculate_earliest_start_times();
+        reoptimize_sequenced_machines(machine_order, step, &makespan, REOPTIMIZATION_ITERATIONS);
     }
 
-    update_job_completion_times();
+    update_schedule_from_graph();
     best_makespan = calculate_makespan();
     printf("\nMakespan inicial: %d\n", best_makespan);
 
     printf("\nFase 2: Melhorando escalonamento (sequencial)...\n");
     int iteration = 0;
-    int improved = 1;
+    int changed = 1;
 
-    // Loop de melhoria até não haver melhorias ou atingir limite de iterações
-    while (improved && iteration < 10)
+    // Iterações até o grafo deixar de mudar ou atingir o limite de iterações
+    while (changed && iteration < IMPROVEMENT_ITERATIONS * num_machines)
     {
-        improved = 0;
         iteration++;
         printf("\nIteracao %d de melhoria:\n", iteration);
-
-        for (int m = 0; m < num_machines; m++)
-        {
-            if (try_improve_machine_schedule(m))
-            {
-                improved = 1;
-            }
-        }
-
-        if (!improved)
+        changed = improve_best_machine(machine_order, num_machines, &makespan, 1, 1);
+        if (!changed)
         {
             printf("Nenhuma melhoria encontrada nesta iteracao.\n");
         }
     }
 
+    // O trabalho das avaliações conta nas métricas do grafo
+    graph.carlier_nodes += trial.carlier_nodes;
+    graph.carlier_truncated += trial.carlier_truncated;
+    graph.cycles_repaired += trial.cycles_repaired;
+    graph.updates += trial.updates;
+    graph.updated_operations += trial.updated_operations;
+    graph.reorders += trial.reorders;
+    workspace_free(&trial);
+    free(candidate_makespan);
+    free(candidate_changed);
+    free(candidate_sequences);
+
+    update_schedule_from_graph();
+    best_makespan = calculate_makespan();
+
     printf("\nAlgoritmo Shifting Bottleneck Sequencial concluido.\n");
     printf("Makespan final: %d\n", best_makespan);
     printf("Iteracoes de melhoria: %d\n", iteration);
+
+    free(machine_order);
+    free(candidate_value);
 }
 
 // Função principal
@@ -414,13 +1215,30 @@ int main(int argc, char **argv)
     {
         for (int m = 0; m < num_machines; m++)
         {
-            fprintf(output, "%d ", best_schedule[j][m]);
+            fprintf(output, "%d ", best_schedule[j * num_machines + m]);
         }
         fprintf(output, "\n");
     }
     // Escreve métricas no ficheiro de métricas
     fprintf(metrics, "Tempo de execucao: %.4f segundos\n", elapsed);
     fprintf(metrics, "Makespan: %d\n", best_makespan);
+    fprintf(metrics, "Lower bound (gargalo inicial): %d\n", initial_lower_bound);
+    fprintf(metrics, "Nos de Carlier: %lld\n", graph.carlier_nodes);
+    fprintf(metrics, "Subproblemas de Carlier truncados: %lld\n", graph.carlier_truncated);
+    fprintf(metrics, "Reotimizacoes aceites: %lld\n", reoptimizations_accepted);
+    fprintf(metrics, "Movimentos laterais: %lld\n", sideways_moves);
+    fprintf(metrics, "Reotimizacoes avaliadas: %lld\n", reoptimization_evaluations);
+    fprintf(metrics, "Sequencias com ciclo corrigidas: %lld\n", graph.cycles_repaired);
+    fprintf(metrics, "Atualizacoes incrementais do grafo: %lld (media de %.1f operacoes recalculadas)\n", graph.updates,
+            graph.updates > 0 ? (double)graph.updated_operations / graph.updates : 0.0);
+    fprintf(metrics, "Reordenacoes topologicas: %lld\n", graph.reorders);
+    int critical_operations = 0;
+    for (int id = 0; id < num_jobs * num_machines; id++)
+    {
+        critical_operations += operation_is_critical(&graph, id);
+    }
+    fprintf(metrics, "Operacoes no caminho critico: %d\n", critical_operations);
+    fprintf(metrics, "Memoria reservada: %.1f KB\n", allocated_bytes / 1024.0);
     fprintf(metrics, "Algoritmo: Shifting Bottleneck Sequencial\n");
     fprintf(metrics, "Ficheiro de entrada: %s\n", input_filename);
 
@@ -438,8 +1256,9 @@ int main(int argc, char **argv)
         printf("Job %d: ", j);
         for (int op = 0; op < num_machines; op++)
         {
-            printf("Op%d(M%d,t=%d->%d) ", op, job_machine[j][op],
-                   best_schedule[j][op], best_schedule[j][op] + job_duration[j][op]);
+            int id = j * num_machines + op;
+            printf("Op%d(M%d,t=%d->%d) ", op, operation_machine[id],
+                   best_schedule[id], best_schedule[id] + operation_duration[id]);
         }
         printf("\n");
     }